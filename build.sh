@@ -17,12 +17,18 @@ mkdir -p $TARGET
 # This can be overridden with:
 # --build-type MinSizeRel
 # --build-type Debug
+# --gravity-cache /path/to/gravity.bin
+# --threads
 BUILD_TYPE=Release
+GRAVITY_CACHE=
+THREADS=OFF
 
 # Parse arguments
 while [ $# -gt 0 ]; do
   case $1 in
     --build-type) BUILD_TYPE="$2"; shift ;;
+    --gravity-cache) GRAVITY_CACHE="$(realpath "$2")"; shift ;;
+    --threads) THREADS=ON ;;
     *) echo "ERROR: Unknown parameter: $1" >&2; exit 1 ;;
   esac
   shift
@@ -59,6 +65,7 @@ echo "============================================="
   mkdir -p $DEPS/playground
   cd $DEPS/playground
   emcmake cmake $SOURCE_DIR -Wno-dev -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DCMAKE_RUNTIME_OUTPUT_DIRECTORY="$SOURCE_DIR/dist" \
-    -DCORRADE_RC_EXECUTABLE="$TARGET/bin/corrade-rc"
+    -DCORRADE_RC_EXECUTABLE="$TARGET/bin/corrade-rc" -DPLAYGROUND_GRAVITY_CACHE="$GRAVITY_CACHE" \
+    -DPLAYGROUND_ENABLE_THREADS=$THREADS
   make
 )
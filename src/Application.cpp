@@ -1,15 +1,27 @@
-#include "ColoredDrawable.h"
-#include "GravityBox.h"
-#include "MovingSphere.h"
+#include "CompactPhongGL.h"
+#include "DebugWireframe.h"
+#include "FrustumCuller.h"
+#include "InputRecording.h"
+#include "InstanceStore.h"
+#include "InstancedMesh.h"
+#include "MeshBatch.h"
+#include "OcclusionCuller.h"
 #include "OrbitCamera.h"
-#include "Rigidbody.h"
+#include "ProfileHistory.h"
+#include "Simulation.h"
+#ifdef PLAYGROUND_THREADS
+#include "SimulationThread.h"
+#endif
+#include "ThreadPool.h"
 
 #include <Corrade/Containers/GrowableArray.h>
 #include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/String.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Path.h>
 #include <Magnum/BulletIntegration/DebugDraw.h>
 #include <Magnum/GL/DefaultFramebuffer.h>
 #include <Magnum/GL/Renderer.h>
-#include <Magnum/MeshTools/Compile.h>
 #include <Magnum/MeshTools/Transform.h>
 #include <Magnum/Timeline.h>
 #ifdef CORRADE_TARGET_EMSCRIPTEN
@@ -21,22 +33,28 @@
 #include <Magnum/Primitives/Cube.h>
 #include <Magnum/Primitives/UVSphere.h>
 #include <Magnum/SceneGraph/Camera.h>
-#include <Magnum/SceneGraph/Scene.h>
+#include <Magnum/Shaders/FlatGL.h>
 #include <Magnum/Shaders/PhongGL.h>
 #include <Magnum/Trade/MeshData.h>
+#ifdef PLAYGROUND_GRAVITY_CACHE
+#include <Corrade/Utility/Resource.h>
+#endif
+
+#include <cstdio>
+#include <utility>
 
 namespace GraphicsPlayground {
 
 using namespace Magnum;
 using namespace Math::Literals;
 
-typedef SceneGraph::Object<SceneGraph::MatrixTransformation3D> Object3D;
-typedef SceneGraph::Scene<SceneGraph::MatrixTransformation3D> Scene3D;
-
 class Application : public Platform::Application {
  public:
     explicit Application(const Arguments &arguments);
 
+    /* Saves the recording, if any */
+    ~Application();
+
  private:
     void viewportEvent(ViewportEvent &event) override;
     void keyPressEvent(KeyEvent &event) override;
@@ -49,49 +67,154 @@ class Application : public Platform::Application {
     void drawEvent() override;
     void showMenu();
 
+    /* Input of the next frame, from the replay if there's one, otherwise
+       from the user and recorded if recording */
+    InputFrame nextInputFrame();
+
+    /* Sets the end checksum and writes the recording to its file, after
+       which it's no longer recorded */
+    void saveRecording();
+
+    /* What the collision shapes are drawn with */
+    enum class DebugDraw : UnsignedByte { Off, Instanced, BulletLines };
+
     ImGuiIntegration::Context _imgui{NoCreate};
 
     Color4 _clearColor = 0x000000ff_rgbaf;
 
-    GL::Mesh _box{NoCreate}, _sphere{NoCreate};
-    GL::Buffer _boxInstanceBuffer{NoCreate}, _sphereInstanceBuffer{NoCreate};
+    /* Has to outlive the meshes added to it */
+    MeshBatch _batch{NoCreate};
+    InstancedMesh _box{NoCreate}, _sphere{NoCreate};
     Shaders::PhongGL _shader{NoCreate};
+    CompactPhongGL _compactShader{NoCreate}, _batchShader{NoCreate};
+    OcclusionCuller _occlusionCuller;
+    /* Mesh the ground is rasterized with as an occluder */
+    Containers::Array<Vector3> _occluderPositions;
+    Containers::Array<UnsignedInt> _occluderIndices;
     BulletIntegration::DebugDraw _debugDraw{NoCreate};
-    Containers::Array<InstanceData> _boxInstanceData, _sphereInstanceData;
-
-    btDbvtBroadphase _bBroadphase;
-    btDefaultCollisionConfiguration _bCollisionConfig;
-    btCollisionDispatcher _bDispatcher{&_bCollisionConfig};
-    btSequentialImpulseConstraintSolver _bSolver;
-
-    /* The world has to live longer than the scene because RigidBody
-       instances have to remove themselves from it on destruction */
-    btDiscreteDynamicsWorld _bWorld{&_bDispatcher, &_bBroadphase, &_bSolver,
-                                    &_bCollisionConfig};
-
-    Scene3D _scene;
+    Shaders::FlatGL3D _wireframeShader{NoCreate};
+    DebugWireframe _boxWireframe{NoCreate}, _sphereWireframe{NoCreate};
+
+    /* Fills the instance buffers in parallel, has to outlive the stores
+       using it */
+    ThreadPool _fillThreads;
+    /* Have to outlive the simulation as bodies remove their instances on
+       destruction */
+    InstanceStore _boxInstances, _sphereInstances;
+
+    Simulation _simulation;
+#ifdef PLAYGROUND_THREADS
+    /* Stops the thread before the simulation is destroyed */
+    SimulationThread _simulationThread{_simulation};
+#endif
+    /* The camera is in a scene of its own so it's not touched by the
+       simulation thread */
+    Scene3D _cameraScene;
     SceneGraph::Camera3D *_camera;
-    SceneGraph::DrawableGroup3D _drawables;
     Timeline _timeline;
 
     OrbitCamera *_orbitCamera;
 
-    MovingSphere *_ball;
     Vector3 _playerInput;
     Vector2 _cameraInput;
     bool _desiredJump{false};
 
-    GravityBox *_gravityBox;
-
-    btBoxShape _bBoxShape{{0.5f, 0.5f, 0.5f}};
-    btSphereShape _bSphereShape{0.5f};
-    btBoxShape _bGroundShape{{4.0f, 4.0f, 4.0f}};
-
-    bool _showMenu{false}, _drawCubes{true}, _drawDebug{true};
+    bool _showMenu{false}, _drawCubes{true};
+    DebugDraw _debugDrawMode{DebugDraw::Instanced};
+    /* Distance from the camera the instanced wireframes are drawn up to,
+       zero for all */
+    Float _debugDrawRadius{};
+#ifdef PLAYGROUND_THREADS
+    bool _threadedSimulation{true};
+#endif
+    bool _compactInstances{true}, _cullInstances{true},
+        _occludeInstances{true}, _meshLevels{true}, _sortInstances{false},
+        _multiDraw{true}, _parallelFill{true};
+
+    /* Instance upload and culling statistics of the last frame and in
+       total */
+    std::size_t _instanceUploadSize{}, _instanceReallocations{},
+        _totalInstanceReallocations{};
+    std::size_t _visibleInstances{}, _occludedInstances{},
+        _drawnInstances{}, _drawnTriangles{}, _debugInstances{};
+    Double _sortTime{};
+    Float _tickRate{60.0f}, _interpolation{};
+    Int _physicsThreads{1};
+    Int _ticksPerFrame{};
+    /* Physics counters of the last tick, from the simulation thread's
+       snapshot while it runs */
+    PhysicsStatistics _physicsStatistics;
+    const PhysicsStatistics *_shownPhysicsStatistics{&_physicsStatistics};
+    Containers::Optional<BakedGravityField::ErrorReport> _gravityBakeReport;
+
+    /* Session recorded with --record or replayed with --replay. Both run
+       the simulation on the main thread. Once the replay runs out of
+       frames, the user takes over again. */
+    Containers::String _recordingFile;
+    Containers::Optional<InputRecording> _recording;
+    bool _replaying{};
+    std::size_t _replayedFrames{};
+    /* Whether the replay arrived at the recorded checksum, once it ends */
+    Containers::Optional<bool> _replayMatches;
+#ifdef PLAYGROUND_PROFILER
+    ProfileHistory _profileHistory;
+    /* Frames the trace is captured for and the events written by the last
+       capture, -1 if it failed */
+    Int _traceFrames{60};
+    Containers::Optional<Long> _tracedEvents;
+#endif
 };
 
 Application::Application(const Arguments &arguments)
     : Platform::Application(arguments, NoCreate) {
+#ifdef PLAYGROUND_PROFILER
+    Profiler::setThreadName("Main");
+#endif
+
+    /* Threads Bullet steps the world with, if built multithreaded */
+    {
+        Utility::Arguments args;
+        args.addOption("physics-threads", "0")
+            .setHelp("physics-threads",
+                     "threads to step the physics with, 0 for all available",
+                     "N")
+            .addOption("record")
+            .setHelp("record", "record the input of the session to a file",
+                     "FILE")
+            .addOption("replay")
+            .setHelp("replay", "replay a session recorded with --record",
+                     "FILE")
+            .addSkippedPrefix("magnum", "engine-specific options")
+            .parse(arguments.argc, arguments.argv);
+        if (const Int count = args.value<Int>("physics-threads"))
+            Simulation::setThreadCount(count);
+        _physicsThreads = Simulation::threadCount();
+
+        if (!args.value("replay").isEmpty()) {
+            const Containers::Optional<Containers::Array<char>> data =
+                Utility::Path::read(args.value("replay"));
+            if (data)
+                _recording = InputRecording::deserialize(*data);
+            if (!_recording)
+                Fatal{} << "Can't replay" << args.value("replay");
+            _replaying = true;
+        } else if (!args.value("record").isEmpty()) {
+            _recordingFile = args.value("record");
+            _recording = InputRecording{};
+        }
+#ifdef PLAYGROUND_THREADS
+        /* The simulation thread ticks by its own clock */
+        if (_recording)
+            _threadedSimulation = false;
+#endif
+        /* Multithreaded Bullet doesn't step the same way every time, so
+           recordings are made and replayed with just one thread */
+        if (_recording) {
+            Simulation::setThreadCount(1);
+            _physicsThreads = 1;
+        }
+    }
+
     /* Try 8x MSAA, fall back to zero samples if not possible. Enable only 2x
        MSAA if we have enough DPI. */
     {
@@ -128,7 +251,7 @@ Application::Application(const Arguments &arguments)
         GL::Renderer::BlendFunction::OneMinusSourceAlpha);
 
     /* Camera setup */
-    _orbitCamera = new OrbitCamera{&_scene};
+    _orbitCamera = new OrbitCamera{&_cameraScene};
     (_camera = new SceneGraph::Camera3D(*_orbitCamera))
         ->setAspectRatioPolicy(SceneGraph::AspectRatioPolicy::Extend)
         .setProjectionMatrix(
@@ -142,18 +265,40 @@ Application::Application(const Arguments &arguments)
     _shader.setAmbientColor(0x111111_rgbf)
         .setSpecularColor(0x330000_rgbf)
         .setLightPositions({{10.0f, 15.0f, 5.0f, 0.0f}});
+    _compactShader = CompactPhongGL{};
+    _compactShader.setAmbientColor(0x111111_rgbf)
+        .setSpecularColor(0x330000_rgbf)
+        .setLightDirection({10.0f, 15.0f, 5.0f});
+    _batchShader = CompactPhongGL{MeshBatch::isMultiDrawSupported()
+                                      ? CompactPhongGL::Flag::MultiDraw
+                                      : CompactPhongGL::Flag::InstanceTexture};
+    _batchShader.setAmbientColor(0x111111_rgbf)
+        .setSpecularColor(0x330000_rgbf)
+        .setLightDirection({10.0f, 15.0f, 5.0f});
 
-    /* Box and sphere mesh, with an (initially empty) instance buffer */
-    _box = MeshTools::compile(Primitives::cubeSolid());
-    _sphere = MeshTools::compile(Primitives::uvSphereSolid(16, 32));
-    _boxInstanceBuffer = GL::Buffer{};
-    _sphereInstanceBuffer = GL::Buffer{};
-    _box.addVertexBufferInstanced(
-        _boxInstanceBuffer, 1, 0, Shaders::PhongGL::TransformationMatrix{},
-        Shaders::PhongGL::NormalMatrix{}, Shaders::PhongGL::Color3{});
-    _sphere.addVertexBufferInstanced(
-        _sphereInstanceBuffer, 1, 0, Shaders::PhongGL::TransformationMatrix{},
-        Shaders::PhongGL::NormalMatrix{}, Shaders::PhongGL::Color3{});
+    /* Box and sphere mesh, with (initially empty) instance buffers. All of
+       them are in the batch as well, to be drawn with a single call. */
+    _batch = MeshBatch{};
+    {
+        const Trade::MeshData cube = Primitives::cubeSolid();
+        _box = InstancedMesh{cube, &_batch};
+        _occluderPositions = cube.positions3DAsArray();
+        _occluderIndices = cube.indicesAsArray();
+    }
+    /* Far away spheres get coarser tessellations, down to 48 triangles. The
+       box can't get any simpler. */
+    _sphere = InstancedMesh{Primitives::uvSphereSolid(16, 32), &_batch};
+    _sphere.addLevel(Primitives::uvSphereSolid(8, 16), 24.0f)
+        .addLevel(Primitives::uvSphereSolid(4, 8), 8.0f);
+
+    /* Collision shapes of the boxes and the sphere, matching them at unit
+       scale like the solid meshes do */
+    _wireframeShader = Shaders::FlatGL3D{
+        Shaders::FlatGL3D::Configuration{}.setFlags(
+            Shaders::FlatGL3D::Flag::InstancedTransformation)};
+    _wireframeShader.setColor(0xffffff_rgbf);
+    _boxWireframe = DebugWireframe{Primitives::cubeWireframe()};
+    _sphereWireframe = DebugWireframe{Primitives::uvSphereWireframe(8, 16)};
 
     /* Setup the renderer so we can draw the debug lines on top */
     GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
@@ -164,45 +309,48 @@ Application::Application(const Arguments &arguments)
     /* Bullet setup */
     _debugDraw = BulletIntegration::DebugDraw{};
     _debugDraw.setMode(BulletIntegration::DebugDraw::Mode::DrawWireframe);
-    _bWorld.setDebugDrawer(&_debugDraw);
-
-    /* Create the ground */
-    auto *ground = new RigidBody{&_scene, 0.0f, &_bGroundShape, _bWorld};
-    new ColoredDrawable{*ground, _boxInstanceData, 0xffffff_rgbf,
-                        Matrix4::scaling({4.0f, 4.0f, 4.0f}), _drawables};
-
-    /* Create boxes with random colors */
+    _simulation.world().setDebugDrawer(&_debugDraw);
+
+    /* The ground */
+    _simulation.ground().attachInstance(_boxInstances, 0xffffff_rgbf, 4.0f);
+
+    /* Create boxes with random colors, a replay starts with the boxes it
+       was recorded with */
+    Containers::Array<Vector3> boxes;
+    if (_replaying) {
+        arrayAppend(boxes, _recording->boxes());
+    } else {
+        for (Int i = 0; i != 2; ++i)
+            for (Int j = 0; j != 2; ++j)
+                for (Int k = 0; k != 2; ++k)
+                    arrayAppend(boxes,
+                                Vector3{i - 2.0f, j + 4.0f, k - 2.0f});
+    }
     Deg hue = 42.0_degf;
-    for (Int i = 0; i != 2; ++i) {
-        for (Int j = 0; j != 2; ++j) {
-            for (Int k = 0; k != 2; ++k) {
-                auto *o = new RigidBody{&_scene, 1.0f, &_bBoxShape, _bWorld};
-                o->rigidBody().setGravity(btVector3{0.0, -10, 0.0f});
-                o->translate({i - 2.0f, j + 4.0f, k - 2.0f});
-                o->syncPose();
-                new ColoredDrawable{
-                    *o, _boxInstanceData,
-                    Color3::fromHsv({hue += 137.5_degf, 0.75f, 0.9f}),
-                    Matrix4::scaling(Vector3{0.5f}), _drawables};
-            }
-        }
+    for (const Vector3 &position : boxes) {
+        auto *o = _simulation.addBox(position);
+        o->attachInstance(_boxInstances,
+                          Color3::fromHsv({hue += 137.5_degf, 0.75f, 0.9f}),
+                          0.5f);
+        if (_recording && !_replaying)
+            _recording->addBox(position);
     }
 
-    _ball = new MovingSphere{&_scene, &_bSphereShape, _bWorld};
-    _ball->translate({0.0f, 4.0f, 0.0f});
-    _ball->rigidBody().setFriction(1.0f);
-    _ball->rigidBody().setRollingFriction(0.1f);
-    _ball->rigidBody().setSpinningFriction(0.1f);
-
-    /* Has to be done explicitly after the translate() above, as Magnum ->
-       Bullet updates are implicitly done only for kinematic bodies */
-    _ball->syncPose();
-
-    new ColoredDrawable{*_ball, _sphereInstanceData, 0x220000_rgbf,
-                        Matrix4::scaling(Vector3{0.5f}), _drawables};
-
-    _gravityBox = new GravityBox(19.62f, Vector3{4.0f, 4.0f, 4.0f}, 0.0f, 0.0f,
-                                 8.0f, 12.0f);
+    /* The sphere */
+    _simulation.ball().attachInstance(_sphereInstances, 0x220000_rgbf, 0.5f);
+
+    /* Use the gravity baked by playground-gravitybake, if it was embedded.
+       Recordings always use the gravity sources, as a headless replay
+       doesn't have the baked field. */
+#ifdef PLAYGROUND_GRAVITY_CACHE
+    if (!_recording) {
+        const Utility::Resource rs{"playground-data"};
+        Containers::Optional<BakedGravityField> baked =
+            BakedGravityField::deserialize(rs.getRaw("gravity.bin"));
+        if (baked)
+            _simulation.setBakedGravity(std::move(*baked));
+    }
+#endif
 
     /* Start the timer, loop at 60 Hz max */
 #ifndef CORRADE_TARGET_EMSCRIPTEN
@@ -212,6 +360,56 @@ Application::Application(const Arguments &arguments)
     _timeline.start();
 }
 
+Application::~Application() {
+    if (_recording && !_replaying)
+        saveRecording();
+}
+
+InputFrame Application::nextInputFrame() {
+    if (_replaying) {
+        const Containers::ArrayView<const InputFrame> frames =
+            _recording->frames();
+        if (_replayedFrames != frames.size())
+            return frames[_replayedFrames++];
+
+        /* The replay ended in the previous frame */
+        const Containers::Optional<UnsignedLong> checksum =
+            _recording->checksum();
+        _replayMatches = checksum && *checksum == _simulation.stateChecksum();
+        Debug{} << "Replayed" << frames.size() << "frames, the end state"
+                << (*_replayMatches ? "matches" : "doesn't match")
+                << "the recording";
+        _recording = Containers::NullOpt;
+        _replaying = false;
+    }
+
+    /* The input space is the camera, of which the ball controls use just
+       the right and backward axis */
+    const Matrix4 inputSpace = _orbitCamera->transformationMatrix();
+    InputFrame frame{};
+    frame.duration = _timeline.previousFrameDuration();
+    frame.tickRate = _tickRate;
+    frame.inputRight = inputSpace.right();
+    frame.inputBackward = inputSpace.backward();
+    frame.ballInputX = Byte(_playerInput.x());
+    frame.ballInputZ = Byte(_playerInput.z());
+    frame.jump = _desiredJump;
+    _desiredJump = false;
+    if (_recording)
+        _recording->addFrame(frame);
+    return frame;
+}
+
+void Application::saveRecording() {
+    _recording->setChecksum(_simulation.stateChecksum());
+    if (Utility::Path::write(_recordingFile, _recording->serialize()))
+        Debug{} << "Recorded" << _recording->frames().size()
+                << "frames to" << _recordingFile;
+    else
+        Error{} << "Can't write" << _recordingFile;
+    _recording = Containers::NullOpt;
+}
+
 void Application::viewportEvent(ViewportEvent &event) {
     /* Resize the main framebuffer */
     GL::defaultFramebuffer.setViewport({{}, event.framebufferSize()});
@@ -225,6 +423,13 @@ void Application::viewportEvent(ViewportEvent &event) {
 }
 
 void Application::drawEvent() {
+    /* Gather the phases of the previous frame, this one is recorded until
+       the end of the function */
+#ifdef PLAYGROUND_PROFILER
+    _profileHistory.nextFrame();
+#endif
+    PLAYGROUND_PROFILE(Frame);
+
     GL::defaultFramebuffer.clear(GL::FramebufferClear::Color |
                                  GL::FramebufferClear::Depth);
     _imgui.newFrame();
@@ -235,88 +440,195 @@ void Application::drawEvent() {
     else if (!ImGui::GetIO().WantTextInput && isTextInputActive())
         stopTextInput();
 
-    /* Housekeeping: remove any objects which are far away from the origin */
-    for (Object3D *obj = _scene.children().first(); obj;) {
-        Object3D *next = obj->nextSibling();
-        if (obj->transformation().translation().dot() > 100 * 100)
-            delete obj;
-
-        obj = next;
+    /* Run the fixed physics ticks that fit into the frame, each of them
+       adjusts the velocity of the sphere and updates the gravity of all
+       bodies. The instances get the state interpolated between the last
+       two ticks. */
+    Vector3 spherePosition, upAxis;
+#ifdef PLAYGROUND_THREADS
+    if (_threadedSimulation != _simulationThread.isRunning()) {
+        if (_threadedSimulation)
+            _simulationThread.start();
+        else
+            _simulationThread.stop();
     }
-
-    /* Step bullet simulation */
-    _bWorld.stepSimulation(_timeline.previousFrameDuration(), 5);
-
-    /* Get position of the sphere */
-    const Vector3 spherePosition =
-        Vector3{_ball->rigidBody().getCenterOfMassPosition()};
-
-    /* Get gravity and up-pointing vector */
-    Vector3 upAxis;
-    Vector3 gravity = _gravityBox->getGravity(spherePosition, &upAxis);
-
-    /* Set gravity of the sphere */
-    _ball->rigidBody().setGravity(btVector3{gravity});
-
-    /* Adjust velocity of the sphere */
-    _ball->adjustVelocity(_timeline, _orbitCamera->transformationMatrix(),
-                          _playerInput, upAxis);
-
-    /* Jump if needed */
-    if (_desiredJump) {
-        _desiredJump = false;
-        _ball->jump(gravity, upAxis);
+    if (_simulationThread.isRunning()) {
+        /* The jump stays desired if the thread didn't keep up with the
+           input */
+        if (_simulationThread.pushInput(
+                {_orbitCamera->transformationMatrix(), _playerInput,
+                 _tickRate, _physicsThreads, _desiredJump}))
+            _desiredJump = false;
+        _shownPhysicsStatistics = &_simulationThread.update().statistics;
+        _ticksPerFrame = _simulationThread.updateTickCount();
+        _interpolation = _simulationThread.interpolation();
+        spherePosition = _simulationThread.interpolatedBallPosition();
+        upAxis = _simulationThread.ballUpAxis();
+    } else
+#endif
+    {
+        /* Everything the simulation gets from the user goes through the
+           frame, so it can be recorded and replayed */
+        if (Simulation::threadCount() != _physicsThreads)
+            Simulation::setThreadCount(_physicsThreads);
+        _ticksPerFrame = _simulation.runFrame(nextInputFrame());
+        if (_ticksPerFrame)
+            _simulation.writeStatistics(_physicsStatistics);
+        _shownPhysicsStatistics = &_physicsStatistics;
+        _interpolation = _simulation.interpolation();
+        spherePosition = _simulation.interpolatedBallPosition();
+        upAxis = _simulation.ballUpAxis();
     }
 
     /* Keep the camera focused on the sphere */
-    _orbitCamera->focus(_timeline, _cameraInput, spherePosition, upAxis);
+    {
+        PLAYGROUND_PROFILE(Camera);
+        _orbitCamera->focus(_timeline, _cameraInput, spherePosition, upAxis);
+    }
 
     if (_drawCubes) {
-        /* Populate instance data with transformations and colors */
-        arrayResize(_boxInstanceData, 0);
-        arrayResize(_sphereInstanceData, 0);
-        _camera->draw(_drawables);
-
-        _shader.setProjectionMatrix(_camera->projectionMatrix());
-
-        /* Upload instance data to the GPU (orphaning the previous buffer
-           contents) and draw all cubes in one call, and all spheres (if any)
-           in another call */
-        _boxInstanceBuffer.setData(_boxInstanceData,
-                                   GL::BufferUsage::DynamicDraw);
-        _box.setInstanceCount(_boxInstanceData.size());
-        _shader.draw(_box);
-
-        _sphereInstanceBuffer.setData(_sphereInstanceData,
-                                      GL::BufferUsage::DynamicDraw);
-        _sphere.setInstanceCount(_sphereInstanceData.size());
-        _shader.draw(_sphere);
+        /* The instance transformations are in world space, the camera
+           transformation is applied on top */
+        const Matrix4 cameraMatrix = _camera->cameraMatrix();
+        const FrustumCuller culler{_camera->projectionMatrix() *
+                                   cameraMatrix};
+        InstancedMesh::View view;
+        if (_cullInstances)
+            view.culler = &culler;
+
+        /* The ground is the only large occluder */
+        if (_occludeInstances) {
+            _occlusionCuller.clear(_camera->projectionMatrix() * cameraMatrix);
+            _occlusionCuller.addOccluder(
+                _occluderPositions, _occluderIndices,
+                _simulation.ground().transformationMatrix() *
+                    Matrix4::scaling(_simulation.groundHalfExtents()));
+            view.occlusionCuller = &_occlusionCuller;
+        }
+
+        const Matrix4 cameraTransformation = cameraMatrix.invertedRigid();
+        view.cameraPosition = cameraTransformation.translation();
+        view.viewDirection = -cameraTransformation.backward();
+        view.sortFrontToBack = _sortInstances;
+
+        /* Levels of detail are selected by the projected radius in pixels,
+           with the vertical field of view as the aspect ratio policy
+           extends the horizontal one */
+        if (_meshLevels)
+            view.pixelsPerUnit = _camera->projectionMatrix()[1][1] *
+                                 Float(_camera->viewport().y()) * 0.5f;
+
+        /* Move settled instances to the static partitions, which stay
+           resident on the GPU and only get the ranges that changed. The
+           rest, without instances outside of the frustum, is uploaded to
+           the next buffer of the instance streams. All cubes are drawn in
+           two calls, and all spheres (if any) in one call for each level of
+           detail in addition. The instance data is written in chunks spread
+           across the fill threads, all done before it's uploaded. */
+        _boxInstances.update();
+        _sphereInstances.update();
+        _boxInstances.setThreadPool(_parallelFill ? &_fillThreads : nullptr);
+        _sphereInstances.setThreadPool(_parallelFill ? &_fillThreads
+                                                     : nullptr);
+        _box.resetStatistics();
+        _sphere.resetStatistics();
+        _batch.resetStatistics();
+        if (_compactInstances && _multiDraw) {
+            /* Everything streamed in one draw call if multi-draw is
+               supported, and a call for each resident static partition
+               that's drawn whole */
+            _batchShader.setProjectionMatrix(_camera->projectionMatrix())
+                .setTransformationMatrix(cameraMatrix)
+                .setNormalMatrix(cameraMatrix.normalMatrix());
+            _batch.clear();
+            _box.addDraws(_boxInstances, view);
+            _sphere.addDraws(_sphereInstances, view);
+            _batch.draw(_batchShader);
+        } else if (_compactInstances) {
+            _compactShader.setProjectionMatrix(_camera->projectionMatrix())
+                .setTransformationMatrix(cameraMatrix)
+                .setNormalMatrix(cameraMatrix.normalMatrix());
+            _box.draw(_compactShader, _boxInstances, view);
+            _sphere.draw(_compactShader, _sphereInstances, view);
+        } else {
+            _shader.setProjectionMatrix(_camera->projectionMatrix())
+                .setTransformationMatrix(cameraMatrix)
+                .setNormalMatrix(cameraMatrix.normalMatrix());
+            _box.draw(_shader, _boxInstances, view);
+            _sphere.draw(_shader, _sphereInstances, view);
+        }
+
+        _instanceUploadSize = _box.uploadedBytes() +
+                              _sphere.uploadedBytes() + _batch.uploadedBytes();
+        _instanceReallocations = _box.reallocations() +
+                                 _sphere.reallocations() +
+                                 _batch.reallocations();
+        _visibleInstances = _box.visibleCount() + _sphere.visibleCount();
+        _occludedInstances = _box.occludedCount() + _sphere.occludedCount();
+        _drawnInstances = _box.drawnCount() + _sphere.drawnCount();
+        _drawnTriangles =
+            _box.drawnTriangleCount() + _sphere.drawnTriangleCount();
+        _sortTime = _box.sortTime() + _sphere.sortTime();
+        _totalInstanceReallocations += _instanceReallocations;
     }
 
     /* Debug draw. If drawing on top of cubes, avoid flickering by setting
-       depth function to <= instead of just <. */
-    if (_drawDebug) {
+       depth function to <= instead of just <. The instanced wireframes are
+       one draw call for the boxes and one for the sphere. Bullet's own
+       lines are generated from the world on the CPU, so they aren't
+       available while the simulation thread is stepping it. */
+    DebugDraw debugDrawMode = _debugDrawMode;
+#ifdef PLAYGROUND_THREADS
+    if (debugDrawMode == DebugDraw::BulletLines &&
+        _simulationThread.isRunning())
+        debugDrawMode = DebugDraw::Off;
+#endif
+    _debugInstances = 0;
+    if (debugDrawMode != DebugDraw::Off) {
+        PLAYGROUND_PROFILE(DebugDraw);
         if (_drawCubes)
             GL::Renderer::setDepthFunction(
                 GL::Renderer::DepthFunction::LessOrEqual);
 
-        _debugDraw.setTransformationProjectionMatrix(
-            _camera->projectionMatrix() * _camera->cameraMatrix());
-        _bWorld.debugDrawWorld();
+        const Matrix4 projectionCameraMatrix =
+            _camera->projectionMatrix() * _camera->cameraMatrix();
+        if (debugDrawMode == DebugDraw::Instanced) {
+            const FrustumCuller culler{projectionCameraMatrix};
+            DebugWireframe::View view;
+            if (_cullInstances)
+                view.culler = &culler;
+            view.cameraPosition =
+                _camera->cameraMatrix().invertedRigid().translation();
+            view.radius = _debugDrawRadius;
+
+            _wireframeShader.setTransformationProjectionMatrix(
+                projectionCameraMatrix);
+            _boxWireframe.draw(_wireframeShader, _boxInstances, view);
+            _sphereWireframe.draw(_wireframeShader, _sphereInstances, view);
+            _debugInstances =
+                _boxWireframe.drawnCount() + _sphereWireframe.drawnCount();
+        } else {
+            _debugDraw.setTransformationProjectionMatrix(
+                projectionCameraMatrix);
+            _simulation.world().debugDrawWorld();
+        }
 
         if (_drawCubes)
             GL::Renderer::setDepthFunction(GL::Renderer::DepthFunction::Less);
     }
 
     /* Menu for parameters */
-    if (_showMenu)
+    if (_showMenu) {
+        PLAYGROUND_PROFILE(Gui);
         showMenu();
+    }
 
     /* Update application cursor */
     _imgui.updateApplicationCursor(*this);
 
     /* Render ImGui window */
     {
+        PLAYGROUND_PROFILE(Gui);
         GL::Renderer::enable(GL::Renderer::Feature::Blending);
         GL::Renderer::disable(GL::Renderer::Feature::FaceCulling);
         GL::Renderer::disable(GL::Renderer::Feature::DepthTest);
@@ -432,10 +744,208 @@ void Application::showMenu() {
         if (ImGui::ColorEdit3("Clear Color", _clearColor.data()))
             GL::Renderer::setClearColor(_clearColor);
         ImGui::Checkbox("Draw cubes", &_drawCubes);
-        ImGui::Checkbox("Draw debug", &_drawDebug);
+        const char *const DebugDrawLabels[]{"Off", "Instanced",
+                                            "Bullet lines"};
+        ImGui::Text("Debug draw:");
+        for (std::size_t i = 0; i != Containers::arraySize(DebugDrawLabels);
+             ++i) {
+            ImGui::SameLine();
+            if (ImGui::RadioButton(DebugDrawLabels[i],
+                                   _debugDrawMode == DebugDraw(i)))
+                _debugDrawMode = DebugDraw(i);
+        }
+        if (_debugDrawMode == DebugDraw::Instanced)
+            ImGui::SliderFloat("Debug radius", &_debugDrawRadius, 0.0f,
+                               100.0f,
+                               _debugDrawRadius > 0.0f ? "%.0f" : "all");
+        ImGui::Checkbox("Compact instances", &_compactInstances);
+        if (_compactInstances)
+            ImGui::Checkbox("Single multi-draw", &_multiDraw);
+        ImGui::Checkbox("Frustum culling", &_cullInstances);
+        ImGui::Checkbox("Occlusion culling", &_occludeInstances);
+        ImGui::Checkbox("Mesh levels of detail", &_meshLevels);
+        ImGui::Checkbox("Front-to-back sorting", &_sortInstances);
+        if (_fillThreads.threadCount() > 1)
+            ImGui::Checkbox("Parallel instance fill", &_parallelFill);
+        ImGui::Text("Visible instances: %zu of %zu, %zu drawn",
+                    _visibleInstances,
+                    _boxInstances.size() + _sphereInstances.size(),
+                    _drawnInstances);
+        ImGui::Text("Occluded instances: %zu", _occludedInstances);
+        ImGui::Text("Drawn triangles: %zu", _drawnTriangles);
+        if (_debugDrawMode == DebugDraw::Instanced)
+            ImGui::Text("Debug wireframes: %zu", _debugInstances);
+        if (_sortInstances)
+            ImGui::Text("Instance sorting: %.3f ms", _sortTime);
+        if (_compactInstances && _multiDraw)
+            ImGui::Text("Batch: %zu draws in %zu calls%s",
+                        _batch.drawCount(), _batch.drawCallCount(),
+                        MeshBatch::isMultiDrawSupported() ? ""
+                                                          : " (no multi-draw)");
+        ImGui::Text("Sphere levels: %zu / %zu / %zu", _sphere.drawnCount(0),
+                    _sphere.drawnCount(1), _sphere.drawnCount(2));
+        ImGui::Text("Static instances: %zu of %zu",
+                    _boxInstances.staticCount() +
+                        _sphereInstances.staticCount(),
+                    _boxInstances.size() + _sphereInstances.size());
+        ImGui::Text("Instance upload: %.1f KiB per frame",
+                    Double(_instanceUploadSize) / 1024.0);
+        ImGui::Text("Instance reallocations: %zu per frame, %zu total",
+                    _instanceReallocations, _totalInstanceReallocations);
+        ImGui::PopID();
+        ImGui::TreePop();
+    }
+
+    /* Fixed tick rate of the physics and the thread it runs on */
+    if (ImGui::TreeNodeEx("Physics", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::PushID("Physics");
+        constexpr const Int TickRates[]{30, 60, 120, 240};
+        const char *const TickRateLabels[]{"30 Hz", "60 Hz", "120 Hz",
+                                           "240 Hz"};
+        for (std::size_t i = 0; i != Containers::arraySize(TickRates); ++i) {
+            if (i)
+                ImGui::SameLine();
+            if (ImGui::RadioButton(TickRateLabels[i],
+                                   Int(_tickRate) == TickRates[i]))
+                _tickRate = Float(TickRates[i]);
+        }
+#ifdef PLAYGROUND_THREADS
+        /* Recordings are made and replayed on the main thread */
+        ImGui::BeginDisabled(bool(_recording));
+        ImGui::Checkbox("Simulation thread", &_threadedSimulation);
+        ImGui::EndDisabled();
+#endif
+#ifdef PLAYGROUND_BULLET_MT
+        ImGui::BeginDisabled(bool(_recording));
+        ImGui::SliderInt("Bullet threads", &_physicsThreads, 1,
+                         Simulation::maxThreadCount());
+        ImGui::EndDisabled();
+#endif
+        ImGui::Text("Ticks: %d this frame, %.2f interpolated",
+                    _ticksPerFrame, Double(_interpolation));
+        if (_replaying) {
+            ImGui::Text("Replaying frame %zu of %zu", _replayedFrames,
+                        _recording->frames().size());
+        } else if (_recording) {
+            ImGui::Text("Recording: %zu frames",
+                        _recording->frames().size());
+            if (ImGui::Button("Save recording"))
+                saveRecording();
+        } else if (_replayMatches) {
+            ImGui::Text("Replay %s the recording",
+                        *_replayMatches ? "matches" : "diverged from");
+        }
+
+        /* Counters of the last tick and where Bullet spent its time */
+        const PhysicsStatistics &statistics = *_shownPhysicsStatistics;
+        ImGui::Text("Pairs: %d, manifolds: %d, contacts: %d",
+                    statistics.overlappingPairs, statistics.manifolds,
+                    statistics.contactPoints);
+        ImGui::Text("Islands: %d, largest with %d bodies",
+                    statistics.islands, statistics.largestIsland);
+        ImGui::Text("Bodies: %d active, %d sleeping, %d disabled",
+                    statistics.activeBodies, statistics.sleepingBodies,
+                    statistics.disabledBodies);
+        ImGui::Text("Substeps: %d of %d needed, at most %d",
+                    statistics.substeps, statistics.requestedSubSteps,
+                    statistics.maxSubSteps);
+        ImGui::Text("Solver: %d iterations per substep",
+                    statistics.solverIterations);
+        ImGui::Text("Clamped frames: %llu",
+                    static_cast<unsigned long long>(
+                        statistics.clampedFrames));
+        if (!statistics.profile.isEmpty() &&
+            ImGui::TreeNode("Bullet profile")) {
+            for (const PhysicsStatistics::ProfileScope &scope :
+                 statistics.profile)
+                ImGui::Text("%*s%s: %.3f ms, %d calls", scope.depth * 2, "",
+                            scope.name, Double(scope.milliseconds),
+                            scope.calls);
+            ImGui::TreePop();
+        }
+        ImGui::PopID();
+        ImGui::TreePop();
+    }
+
+    /* Gravity parameters */
+    if (ImGui::TreeNodeEx("Gravity", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::PushID("Gravity");
+        /* The gravity sources are used by the simulation thread, and
+           recordings are made with them */
+#ifdef PLAYGROUND_THREADS
+        ImGui::BeginDisabled(_simulationThread.isRunning() ||
+                             bool(_recording));
+#else
+        ImGui::BeginDisabled(bool(_recording));
+#endif
+        bool baked = _simulation.bakedGravity() != nullptr;
+        if (ImGui::Checkbox("Baked", &baked)) {
+            _gravityBakeReport = Containers::NullOpt;
+            if (baked)
+                _simulation.bakeGravity(
+                    Range3D{Vector3{-16.0f}, Vector3{16.0f}}, Vector3i{64});
+            else
+                _simulation.clearBakedGravity();
+        }
+
+        if (const BakedGravityField *field = _simulation.bakedGravity()) {
+            const Vector3i size = field->size();
+            ImGui::Text("Grid: %dx%dx%d, %.1f KiB", size.x(), size.y(),
+                        size.z(), Double(field->sampleDataSize()) / 1024.0);
+            if (ImGui::Button("Compare with analytic"))
+                _gravityBakeReport =
+                    field->errorReport(_simulation.gravityFields());
+            if (_gravityBakeReport) {
+                ImGui::Text("Max error: %.3f (of %.3f)",
+                            Double(_gravityBakeReport->maxError),
+                            Double(_gravityBakeReport->maxMagnitude));
+                ImGui::Text("Mean error: %.4f",
+                            Double(_gravityBakeReport->meanError));
+            }
+        }
+        ImGui::EndDisabled();
+
+        ImGui::PopID();
+        ImGui::TreePop();
+    }
+
+#ifdef PLAYGROUND_PROFILER
+    /* Time spent in each phase over the past frames, the phases of the
+       simulation thread count towards the frame they finished in. The
+       capture goes back as many frames as set. */
+    if (ImGui::TreeNode("Profiler")) {
+        ImGui::PushID("Profiler");
+        for (std::size_t i = 0; i != ProfilePhaseCount; ++i) {
+            const ProfilePhase phase = ProfilePhase(i);
+            const Containers::ArrayView<const Float> durations =
+                _profileHistory.durations(phase);
+            char overlay[32];
+            std::snprintf(overlay, sizeof(overlay), "p99 %.2f ms",
+                          Double(_profileHistory.p99(phase)));
+            ImGui::PlotLines(profilePhaseName(phase), durations.data(),
+                             Int(durations.size()),
+                             Int(_profileHistory.offset()), overlay, 0.0f,
+                             Math::max(_profileHistory.max(phase), 0.01f),
+                             {0.0f, 32.0f});
+        }
+        /* The browser build has no filesystem to write the trace to */
+#ifndef CORRADE_TARGET_EMSCRIPTEN
+        ImGui::SliderInt("Frames", &_traceFrames, 1,
+                         ProfileHistory::FrameCount);
+        if (ImGui::Button("Capture trace"))
+            _tracedEvents = Profiler::writeChromeTrace(
+                "playground-trace.json",
+                _profileHistory.frameStart(std::size_t(_traceFrames)));
+        if (_tracedEvents && *_tracedEvents < 0)
+            ImGui::Text("Can't write playground-trace.json");
+        else if (_tracedEvents)
+            ImGui::Text("Wrote %lld events to playground-trace.json",
+                        static_cast<long long>(*_tracedEvents));
+#endif
         ImGui::PopID();
         ImGui::TreePop();
     }
+#endif
 
     ImGui::End();
 }
@@ -0,0 +1,374 @@
+#include "BakedGravityField.h"
+
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/Endianness.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Packing.h>
+
+#include <cstring>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+constexpr const char Magic[4]{'G', 'R', 'A', 'V'};
+constexpr const UnsignedInt Version = 1;
+
+struct BlobHeader {
+    char magic[4];
+    UnsignedInt version;
+    Int size[3];
+    Float min[3];
+    Float max[3];
+    Int priority;
+};
+
+static_assert(sizeof(BlobHeader) == 48, "unexpected blob header padding");
+
+/* Converts between little-endian and the native byte order, both ways */
+void littleEndianInPlace(BlobHeader &header) {
+    Utility::Endianness::littleEndianInPlace(
+        header.version, header.size[0], header.size[1], header.size[2],
+        header.min[0], header.min[1], header.min[2], header.max[0],
+        header.max[1], header.max[2], header.priority);
+}
+
+void littleEndianInPlace(Containers::ArrayView<Vector3us> samples) {
+#ifdef CORRADE_TARGET_BIG_ENDIAN
+    for (Vector3us &sample : samples)
+        Utility::Endianness::swapInPlace(sample.x(), sample.y(), sample.z());
+#else
+    static_cast<void>(samples);
+#endif
+}
+
+/* Owns the memory behind a pair of Vector3Batch instances */
+struct BatchStorage {
+    explicit BatchStorage(std::size_t size) : data{NoInit, 6 * size} {}
+
+    Vector3Batch positions() {
+        const std::size_t size = data.size() / 6;
+        return {data.slice(0, size), data.slice(size, 2 * size),
+                data.slice(2 * size, 3 * size)};
+    }
+
+    Vector3Batch gravity() {
+        const std::size_t size = data.size() / 6;
+        return {data.slice(3 * size, 4 * size),
+                data.slice(4 * size, 5 * size),
+                data.slice(5 * size, 6 * size)};
+    }
+
+    Containers::Array<Float> data;
+};
+
+ConstVector3Batch constBatch(const Vector3Batch &batch) {
+    return {batch.x, batch.y, batch.z};
+}
+
+/* Same operation order as Math::lerp(), so the batched query gives exactly
+   the same result as the scalar one */
+Simd::Pack lerp(Simd::Pack a, Simd::Pack b, Simd::Pack t) {
+    return Simd::add(Simd::mul(Simd::sub(Simd::splat(1.0f), t), a),
+                     Simd::mul(t, b));
+}
+
+}  // namespace
+
+BakedGravityField::BakedGravityField(const Range3D &range,
+                                     const Vector3i &size)
+    : _range(range), _size(size),
+      _inverseSpacing(Vector3{size - Vector3i{1}} / range.size()),
+      _samples{NoInit, std::size_t(size.product())} {}
+
+BakedGravityField::BakedGravityField(const GravityField &field,
+                                     const Range3D &range,
+                                     const Vector3i &size)
+    : BakedGravityField{range, Math::max(size, Vector3i{2})} {
+    CORRADE_ASSERT((size >= Vector3i{2}).all(),
+                   "BakedGravityField: expected size to be at least 2 in "
+                   "each dimension but got"
+                       << size, );
+    setPriority(field.priority());
+
+    /* Evaluate the field one Z slice at a time with the batched query */
+    const Vector3 spacing = range.size() / Vector3{_size - Vector3i{1}};
+    const std::size_t sliceSize = std::size_t(_size.x()) * _size.y();
+    BatchStorage storage{sliceSize};
+    const Vector3Batch positions = storage.positions();
+    const Vector3Batch gravity = storage.gravity();
+    for (Int z = 0; z != _size.z(); ++z) {
+        std::size_t i = 0;
+        for (Int y = 0; y != _size.y(); ++y) {
+            for (Int x = 0; x != _size.x(); ++x, ++i) {
+                positions.x[i] = range.min().x() + x * spacing.x();
+                positions.y[i] = range.min().y() + y * spacing.y();
+                positions.z[i] = range.min().z() + z * spacing.z();
+            }
+        }
+
+        field.getGravity(constBatch(positions), gravity);
+
+        Vector3us *out = _samples.data() + z * sliceSize;
+        for (std::size_t j = 0; j != sliceSize; ++j)
+            out[j] = Math::packHalf(
+                Vector3{gravity.x[j], gravity.y[j], gravity.z[j]});
+    }
+}
+
+Containers::Optional<BakedGravityField> BakedGravityField::deserialize(
+    Containers::ArrayView<const char> data) {
+    BlobHeader header;
+    if (data.size() < sizeof(BlobHeader)) {
+        Error{} << "BakedGravityField::deserialize(): expected at least"
+                << sizeof(BlobHeader) << "bytes but got" << data.size();
+        return {};
+    }
+
+    std::memcpy(&header, data.data(), sizeof(BlobHeader));
+    littleEndianInPlace(header);
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version) {
+        Error{} << "BakedGravityField::deserialize(): invalid header";
+        return {};
+    }
+
+    const Vector3i size{header.size[0], header.size[1], header.size[2]};
+    if (!(size >= Vector3i{2}).all() || !(size <= Vector3i{1024}).all()) {
+        Error{} << "BakedGravityField::deserialize(): invalid size" << size;
+        return {};
+    }
+
+    const std::size_t sampleDataSize =
+        std::size_t(size.product()) * sizeof(Vector3us);
+    if (data.size() != sizeof(BlobHeader) + sampleDataSize) {
+        Error{} << "BakedGravityField::deserialize(): expected"
+                << sizeof(BlobHeader) + sampleDataSize
+                << "bytes for a grid of" << size << "but got" << data.size();
+        return {};
+    }
+
+    /* An empty, inverted or infinite range would make the cell size
+       infinite or NaN. NaNs fail the comparison. */
+    const Range3D range{
+        Vector3{header.min[0], header.min[1], header.min[2]},
+        Vector3{header.max[0], header.max[1], header.max[2]}};
+    if (!(range.min() < range.max()).all() ||
+        Math::isInf(range.size()).any()) {
+        Error{} << "BakedGravityField::deserialize(): invalid range"
+                << range.min() << range.max();
+        return {};
+    }
+
+    Containers::Optional<BakedGravityField> out{
+        BakedGravityField{range, size}};
+    out->setPriority(header.priority);
+    std::memcpy(out->_samples.data(), data.data() + sizeof(BlobHeader),
+                sampleDataSize);
+    littleEndianInPlace(out->_samples);
+    return out;
+}
+
+Range3D BakedGravityField::range() const {
+    return _range;
+}
+
+Vector3i BakedGravityField::size() const {
+    return _size;
+}
+
+std::size_t BakedGravityField::sampleDataSize() const {
+    return _samples.size() * sizeof(Vector3us);
+}
+
+BakedGravityField::ErrorReport BakedGravityField::errorReport(
+    const GravityField &reference) const {
+    ErrorReport report{};
+
+    /* Cell centers, one Z slice at a time */
+    const Vector3 spacing = _range.size() / Vector3{_size - Vector3i{1}};
+    const Vector3i cells = _size - Vector3i{1};
+    const std::size_t sliceSize = std::size_t(cells.x()) * cells.y();
+    BatchStorage storage{sliceSize};
+    const Vector3Batch positions = storage.positions();
+    const Vector3Batch gravity = storage.gravity();
+    Double errorSum = 0.0;
+    for (Int z = 0; z != cells.z(); ++z) {
+        std::size_t i = 0;
+        for (Int y = 0; y != cells.y(); ++y) {
+            for (Int x = 0; x != cells.x(); ++x, ++i) {
+                positions.x[i] = _range.min().x() + (x + 0.5f) * spacing.x();
+                positions.y[i] = _range.min().y() + (y + 0.5f) * spacing.y();
+                positions.z[i] = _range.min().z() + (z + 0.5f) * spacing.z();
+            }
+        }
+
+        reference.getGravity(constBatch(positions), gravity);
+
+        for (std::size_t j = 0; j != sliceSize; ++j) {
+            const Vector3 position{positions.x[j], positions.y[j],
+                                   positions.z[j]};
+            const Vector3 expected{gravity.x[j], gravity.y[j], gravity.z[j]};
+            const Float error = (doGravity(position) - expected).length();
+            errorSum += error;
+            report.maxMagnitude =
+                Math::max(report.maxMagnitude, expected.length());
+            if (error > report.maxError) {
+                report.maxError = error;
+                report.maxErrorPosition = position;
+            }
+        }
+    }
+
+    report.sampleCount = sliceSize * cells.z();
+    report.meanError = Float(errorSum / Double(report.sampleCount));
+    return report;
+}
+
+Containers::Array<char> BakedGravityField::serialize() const {
+    BlobHeader header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    for (Int i = 0; i != 3; ++i) {
+        header.size[i] = _size[i];
+        header.min[i] = _range.min()[i];
+        header.max[i] = _range.max()[i];
+    }
+    header.priority = priority();
+    littleEndianInPlace(header);
+
+    Containers::Array<char> out{NoInit,
+                                sizeof(BlobHeader) + sampleDataSize()};
+    std::memcpy(out.data(), &header, sizeof(BlobHeader));
+    std::memcpy(out.data() + sizeof(BlobHeader), _samples.data(),
+                sampleDataSize());
+    littleEndianInPlace(Containers::arrayCast<Vector3us>(
+        out.exceptPrefix(sizeof(BlobHeader))));
+    return out;
+}
+
+Range3D BakedGravityField::doBounds() const {
+    return _range;
+}
+
+Vector3 BakedGravityField::sample(const Vector3i &coordinates) const {
+    return Vector3{Math::unpackHalf(
+        _samples[(std::size_t(coordinates.z()) * _size.y() + coordinates.y()) *
+                     _size.x() +
+                 coordinates.x()])};
+}
+
+Vector3 BakedGravityField::doGravity(const Vector3 &position) const {
+    /* Grid coordinates, this also rejects NaNs */
+    const Vector3 coordinates = (position - _range.min()) * _inverseSpacing;
+    const Vector3 last{_size - Vector3i{1}};
+    if (!(coordinates >= Vector3{}).all() || !(coordinates <= last).all())
+        return {};
+
+    /* The last sample in each dimension interpolates from the cell before
+       it */
+    const Vector3i cell{
+        Math::min(Math::floor(coordinates), last - Vector3{1.0f})};
+    const Vector3 t = coordinates - Vector3{cell};
+
+    const Vector3 x00 = Math::lerp(
+        sample(cell), sample(cell + Vector3i{1, 0, 0}), t.x());
+    const Vector3 x10 = Math::lerp(sample(cell + Vector3i{0, 1, 0}),
+                                   sample(cell + Vector3i{1, 1, 0}), t.x());
+    const Vector3 x01 = Math::lerp(sample(cell + Vector3i{0, 0, 1}),
+                                   sample(cell + Vector3i{1, 0, 1}), t.x());
+    const Vector3 x11 = Math::lerp(sample(cell + Vector3i{0, 1, 1}),
+                                   sample(cell + Vector3i{1, 1, 1}), t.x());
+    return Math::lerp(Math::lerp(x00, x10, t.y()), Math::lerp(x01, x11, t.y()),
+                      t.z());
+}
+
+void BakedGravityField::doGravityBatch(const ConstVector3Batch &positions,
+                                       const Vector3Batch &gravity) const {
+    const Simd::Pack minX = Simd::splat(_range.min().x());
+    const Simd::Pack minY = Simd::splat(_range.min().y());
+    const Simd::Pack minZ = Simd::splat(_range.min().z());
+    const Simd::Pack inverseSpacingX = Simd::splat(_inverseSpacing.x());
+    const Simd::Pack inverseSpacingY = Simd::splat(_inverseSpacing.y());
+    const Simd::Pack inverseSpacingZ = Simd::splat(_inverseSpacing.z());
+    const Vector3 last{_size - Vector3i{1}};
+
+    /* Offsets of the eight samples of a cell from its first one, X
+       changing the fastest */
+    const std::size_t strideY = _size.x();
+    const std::size_t strideZ = std::size_t(_size.x()) * _size.y();
+    const std::size_t offsets[8]{
+        0,       1,           strideY,           strideY + 1,
+        strideZ, strideZ + 1, strideZ + strideY, strideZ + strideY + 1};
+
+    forEachPack(positions, gravity, [&](const Float *x, const Float *y,
+                                        const Float *z, Float *gx, Float *gy,
+                                        Float *gz) {
+        Float coordinates[3][Simd::Width];
+        Simd::store(coordinates[0],
+                    Simd::mul(Simd::sub(Simd::load(x), minX),
+                              inverseSpacingX));
+        Simd::store(coordinates[1],
+                    Simd::mul(Simd::sub(Simd::load(y), minY),
+                              inverseSpacingY));
+        Simd::store(coordinates[2],
+                    Simd::mul(Simd::sub(Simd::load(z), minZ),
+                              inverseSpacingZ));
+
+        /* There's no gather instruction in any of the targets, so the
+           samples are fetched and unpacked lane by lane into a layout the
+           interpolation can load whole packs from. Lanes outside of the
+           grid get zero samples, which interpolate to zero gravity. */
+        Float t[3][Simd::Width];
+        Float corners[8][3][Simd::Width];
+        for (std::size_t lane = 0; lane != Simd::Width; ++lane) {
+            const Vector3 position{coordinates[0][lane],
+                                   coordinates[1][lane],
+                                   coordinates[2][lane]};
+            if (!(position >= Vector3{}).all() || !(position <= last).all()) {
+                for (Int i = 0; i != 3; ++i) {
+                    t[i][lane] = 0.0f;
+                    for (Int corner = 0; corner != 8; ++corner)
+                        corners[corner][i][lane] = 0.0f;
+                }
+                continue;
+            }
+
+            const Vector3i cell{
+                Math::min(Math::floor(position), last - Vector3{1.0f})};
+            const Vector3 fraction = position - Vector3{cell};
+            const Vector3us *first =
+                _samples.data() +
+                (std::size_t(cell.z()) * _size.y() + cell.y()) * _size.x() +
+                cell.x();
+            for (Int corner = 0; corner != 8; ++corner) {
+                const Vector3 value{Math::unpackHalf(first[offsets[corner]])};
+                for (Int i = 0; i != 3; ++i)
+                    corners[corner][i][lane] = value[i];
+            }
+            for (Int i = 0; i != 3; ++i)
+                t[i][lane] = fraction[i];
+        }
+
+        /* Same order of interpolation as doGravity() */
+        const Simd::Pack tx = Simd::load(t[0]);
+        const Simd::Pack ty = Simd::load(t[1]);
+        const Simd::Pack tz = Simd::load(t[2]);
+        Float *const out[3]{gx, gy, gz};
+        for (Int i = 0; i != 3; ++i) {
+            const Simd::Pack x00 = lerp(Simd::load(corners[0][i]),
+                                        Simd::load(corners[1][i]), tx);
+            const Simd::Pack x10 = lerp(Simd::load(corners[2][i]),
+                                        Simd::load(corners[3][i]), tx);
+            const Simd::Pack x01 = lerp(Simd::load(corners[4][i]),
+                                        Simd::load(corners[5][i]), tx);
+            const Simd::Pack x11 = lerp(Simd::load(corners[6][i]),
+                                        Simd::load(corners[7][i]), tx);
+            Simd::store(out[i], lerp(lerp(x00, x10, ty), lerp(x01, x11, ty),
+                                     tz));
+        }
+    });
+}
+
+}  // namespace GraphicsPlayground
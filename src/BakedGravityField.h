@@ -0,0 +1,80 @@
+#pragma once
+
+#include "GravityField.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Gravity field sampled into a regular grid of half-float vectors, queries
+   trilinearly interpolate the eight surrounding samples. Makes the cost of a
+   query independent of how many analytic fields contribute to it, at the
+   expense of smoothing out sharp transitions such as the edges of a
+   GravityBox. Positions outside of the baked range get no gravity. */
+class BakedGravityField : public GravityField {
+ public:
+    /* Difference between the baked and the analytic field, measured in the
+       middle of each grid cell where the interpolation error is largest */
+    struct ErrorReport {
+        std::size_t sampleCount;
+        Float maxError;
+        Float meanError;
+        Vector3 maxErrorPosition;
+        /* Largest gravity magnitude of the analytic field, to put the errors
+           into perspective */
+        Float maxMagnitude;
+    };
+
+    /* Samples given field at size.x() * size.y() * size.z() positions evenly
+       spaced over given range, including its boundaries. The size is
+       expected to be at least 2 in each dimension. The priority is taken
+       over from the field. */
+    explicit BakedGravityField(const GravityField &field, const Range3D &range,
+                               const Vector3i &size);
+
+    /* Creates a baked field from data produced by serialize(), prints a
+       message and returns an empty optional if the data are invalid */
+    static Containers::Optional<BakedGravityField> deserialize(
+        Containers::ArrayView<const char> data);
+
+    Range3D range() const;
+    Vector3i size() const;
+
+    /* Memory used by the samples, in bytes */
+    std::size_t sampleDataSize() const;
+
+    ErrorReport errorReport(const GravityField &reference) const;
+
+    /* Binary blob with the range, size, priority and the half-float samples,
+       in little-endian */
+    Containers::Array<char> serialize() const;
+
+ private:
+    explicit BakedGravityField(const Range3D &range, const Vector3i &size);
+
+    Range3D doBounds() const override;
+    Vector3 doGravity(const Vector3 &position) const override;
+
+    /* Gathers the samples lane by lane and interpolates a whole SIMD pack
+       at once, with the same result as doGravity() */
+    void doGravityBatch(const ConstVector3Batch &positions,
+                        const Vector3Batch &gravity) const override;
+
+    Vector3 sample(const Vector3i &coordinates) const;
+
+    Range3D _range;
+    Vector3i _size;
+    Vector3 _inverseSpacing;
+
+    /* X changing the fastest, then Y, then Z, so the sample at (x, y, z)
+       is at (z*size.y() + y)*size.x() + x */
+    Containers::Array<Vector3us> _samples;
+};
+
+}  // namespace GraphicsPlayground
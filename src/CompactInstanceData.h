@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Math/Vector4.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Packed alternative to InstanceData, 32 instead of 112 bytes. The rotation
+   is a normalized quaternion stored as signed normalized 16-bit integers,
+   the normal matrix is derived from it in the vertex shader. Only uniform
+   scaling is supported. */
+struct CompactInstanceData {
+    Vector3 translation;
+    Float scale;
+    Vector4s rotation;
+    Color4ub color;
+    /* Keeps the instances aligned to 16 bytes */
+    UnsignedInt padding;
+};
+
+static_assert(sizeof(CompactInstanceData) == 32,
+              "unexpected CompactInstanceData size");
+
+}  // namespace GraphicsPlayground
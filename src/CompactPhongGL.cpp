@@ -0,0 +1,270 @@
+#include "CompactPhongGL.h"
+
+#include "CompactInstanceData.h"
+
+#include <Corrade/Containers/String.h>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Format.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/Version.h>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+constexpr Int InstanceTextureUnit = 0;
+
+constexpr const char *VertexShader = R"GLSL(
+#ifdef MULTI_DRAW
+#extension GL_ANGLE_multi_draw : require
+#define drawIndex gl_DrawID
+#elif defined(INSTANCE_TEXTURE)
+uniform highp int drawIndex;
+#endif
+
+uniform highp mat4 projectionMatrix;
+uniform highp mat4 transformationMatrix;
+uniform mediump mat3 normalMatrix;
+
+in highp vec4 position;
+in mediump vec3 normal;
+
+#ifdef INSTANCE_TEXTURE
+uniform highp usampler2D instances;
+uniform highp uint instanceOffsets[MAX_DRAWS];
+#else
+in highp vec4 instanceTranslationScale;
+in mediump vec4 instanceRotation;
+in lowp vec4 instanceColor;
+#endif
+
+out mediump vec3 transformedNormal;
+out highp vec3 transformedPosition;
+out lowp vec3 interpolatedColor;
+
+/* Rotates a vector by a unit quaternion */
+mediump vec3 rotate(mediump vec4 q, mediump vec3 v) {
+    return v + 2.0*cross(q.xyz, cross(q.xyz, v) + q.w*v);
+}
+
+void main() {
+#ifdef INSTANCE_TEXTURE
+    /* The first texel is the translation and scale, the second the
+       quaternion as four signed 16-bit integers and the color as four
+       bytes. Unpacked the same way as the attributes would be. */
+    highp int instance = int(instanceOffsets[drawIndex]) + gl_InstanceID;
+    highp ivec2 coordinates = ivec2(instance*2%INSTANCE_TEXTURE_WIDTH,
+                                    instance*2/INSTANCE_TEXTURE_WIDTH);
+    highp uvec4 first = texelFetch(instances, coordinates, 0);
+    highp uvec4 second = texelFetch(instances, coordinates + ivec2(1, 0), 0);
+    highp vec4 instanceTranslationScale = uintBitsToFloat(first);
+    mediump vec4 instanceRotation = max(
+        vec4(ivec4(second.xxyy << uvec4(16u, 0u, 16u, 0u)) >> 16)/32767.0,
+        -1.0);
+    lowp vec4 instanceColor =
+        vec4((second.zzzz >> uvec4(0u, 8u, 16u, 24u)) & 0xffu)/255.0;
+#endif
+
+    /* Undo the quantization error of the packed quaternion */
+    mediump vec4 rotation = normalize(instanceRotation);
+
+    highp vec3 worldPosition =
+        rotate(rotation, position.xyz*instanceTranslationScale.w) +
+        instanceTranslationScale.xyz;
+    highp vec4 viewPosition = transformationMatrix*vec4(worldPosition, 1.0);
+    transformedPosition = viewPosition.xyz;
+    gl_Position = projectionMatrix*viewPosition;
+
+    /* The scale is uniform, so the rotation alone is the normal matrix up
+       to a scale factor that gets normalized away */
+    transformedNormal = normalMatrix*rotate(rotation, normal);
+    interpolatedColor = instanceColor.rgb;
+}
+)GLSL";
+
+constexpr const char *FragmentShader = R"GLSL(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+uniform mediump vec3 lightDirection;
+uniform lowp vec3 ambientColor;
+uniform lowp vec3 specularColor;
+uniform mediump float shininess;
+
+in mediump vec3 transformedNormal;
+in highp vec3 transformedPosition;
+in lowp vec3 interpolatedColor;
+
+out lowp vec4 fragmentColor;
+
+void main() {
+    mediump vec3 normalizedNormal = normalize(transformedNormal);
+    mediump vec3 normalizedLight = normalize(lightDirection);
+
+    lowp vec3 color = ambientColor*interpolatedColor;
+    mediump float intensity = max(0.0, dot(normalizedNormal, normalizedLight));
+    color += interpolatedColor*intensity;
+
+    if (intensity > 0.0) {
+        highp vec3 reflection = reflect(-normalizedLight, normalizedNormal);
+        mediump float specularity = pow(
+            max(0.0, dot(normalize(-transformedPosition), reflection)),
+            shininess);
+        color += specularColor*specularity;
+    }
+
+    fragmentColor = vec4(color, 1.0);
+}
+)GLSL";
+
+}  // namespace
+
+CompactPhongGL::CompactPhongGL(const Flags flags) : _flags{flags} {
+#ifndef MAGNUM_TARGET_GLES
+    constexpr const GL::Version version = GL::Version::GL330;
+#else
+    constexpr const GL::Version version = GL::Version::GLES300;
+#endif
+
+    GL::Shader vert{version, GL::Shader::Type::Vertex};
+    GL::Shader frag{version, GL::Shader::Type::Fragment};
+    if (flags & Flag::InstanceTexture)
+        vert.addSource(Utility::format("#define INSTANCE_TEXTURE\n"
+                                       "#define MAX_DRAWS {}\n"
+                                       "#define INSTANCE_TEXTURE_WIDTH {}\n",
+                                       UnsignedInt(MaxDraws),
+                                       UnsignedInt(InstanceTextureWidth)));
+    if (flags >= Flag::MultiDraw)
+        vert.addSource("#define MULTI_DRAW\n");
+    vert.addSource(VertexShader);
+    frag.addSource(FragmentShader);
+    CORRADE_INTERNAL_ASSERT_OUTPUT(vert.compile() && frag.compile());
+
+    attachShaders({vert, frag});
+    bindAttributeLocation(Position::Location, "position");
+    bindAttributeLocation(Normal::Location, "normal");
+    if (!(flags & Flag::InstanceTexture)) {
+        bindAttributeLocation(InstanceTranslationScale::Location,
+                              "instanceTranslationScale");
+        bindAttributeLocation(InstanceRotation::Location, "instanceRotation");
+        bindAttributeLocation(InstanceColor::Location, "instanceColor");
+    }
+    CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+    _projectionMatrixUniform = uniformLocation("projectionMatrix");
+    _transformationMatrixUniform = uniformLocation("transformationMatrix");
+    _normalMatrixUniform = uniformLocation("normalMatrix");
+    _lightDirectionUniform = uniformLocation("lightDirection");
+    _ambientColorUniform = uniformLocation("ambientColor");
+    _specularColorUniform = uniformLocation("specularColor");
+    _shininessUniform = uniformLocation("shininess");
+    if (flags & Flag::InstanceTexture) {
+        _instanceOffsetsUniform = uniformLocation("instanceOffsets");
+        setUniform(uniformLocation("instances"), InstanceTextureUnit);
+    }
+    if ((flags & Flag::InstanceTexture) && !(flags >= Flag::MultiDraw))
+        _drawIndexUniform = uniformLocation("drawIndex");
+
+    /* Same defaults as Shaders::PhongGL */
+    setProjectionMatrix({});
+    setTransformationMatrix({});
+    setNormalMatrix({});
+    setLightDirection({0.0f, 0.0f, 1.0f});
+    setSpecularColor(Color3{1.0f});
+    setShininess(80.0f);
+    if (flags & Flag::InstanceTexture) {
+        const UnsignedInt offsets[MaxDraws]{};
+        setInstanceOffsets(offsets);
+    }
+    if (_drawIndexUniform != -1)
+        setDrawIndex(0);
+}
+
+void CompactPhongGL::addInstanceBuffer(GL::Mesh &mesh, GL::Buffer &buffer,
+                                       GLintptr offset) {
+    mesh.addVertexBufferInstanced(
+        buffer, 1, offset, InstanceTranslationScale{},
+        InstanceRotation{InstanceRotation::DataType::Short,
+                         InstanceRotation::DataOption::Normalized},
+        InstanceColor{InstanceColor::DataType::UnsignedByte,
+                      InstanceColor::DataOption::Normalized},
+        sizeof(CompactInstanceData::padding));
+}
+
+CompactPhongGL &CompactPhongGL::setProjectionMatrix(const Matrix4 &matrix) {
+    setUniform(_projectionMatrixUniform, matrix);
+    return *this;
+}
+
+CompactPhongGL &
+CompactPhongGL::setTransformationMatrix(const Matrix4 &matrix) {
+    setUniform(_transformationMatrixUniform, matrix);
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::setNormalMatrix(const Matrix3x3 &matrix) {
+    setUniform(_normalMatrixUniform, matrix);
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::setLightDirection(const Vector3 &direction) {
+    setUniform(_lightDirectionUniform, direction);
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::setAmbientColor(const Color3 &color) {
+    setUniform(_ambientColorUniform, color);
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::setSpecularColor(const Color3 &color) {
+    setUniform(_specularColorUniform, color);
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::setShininess(Float shininess) {
+    setUniform(_shininessUniform, shininess);
+    return *this;
+}
+
+CompactPhongGL::Flags CompactPhongGL::flags() const {
+    return _flags;
+}
+
+CompactPhongGL &CompactPhongGL::setInstanceOffsets(
+    Containers::ArrayView<const UnsignedInt> offsets) {
+    CORRADE_ASSERT(_flags & Flag::InstanceTexture,
+                   "CompactPhongGL::setInstanceOffsets(): the shader was not "
+                   "created with an instance texture",
+                   *this);
+    CORRADE_ASSERT(offsets.size() <= MaxDraws,
+                   "CompactPhongGL::setInstanceOffsets(): expected at most"
+                       << MaxDraws << "offsets but got" << offsets.size(),
+                   *this);
+    setUniform(_instanceOffsetsUniform, offsets);
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::setDrawIndex(UnsignedInt index) {
+    CORRADE_ASSERT(_drawIndexUniform != -1,
+                   "CompactPhongGL::setDrawIndex(): the shader was not "
+                   "created with an instance texture or uses multi-draw",
+                   *this);
+    setUniform(_drawIndexUniform, Int(index));
+    return *this;
+}
+
+CompactPhongGL &CompactPhongGL::bindInstanceTexture(GL::Texture2D &texture) {
+    CORRADE_ASSERT(_flags & Flag::InstanceTexture,
+                   "CompactPhongGL::bindInstanceTexture(): the shader was "
+                   "not created with an instance texture",
+                   *this);
+    texture.bind(InstanceTextureUnit);
+    return *this;
+}
+
+}  // namespace GraphicsPlayground
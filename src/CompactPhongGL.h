@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/EnumSet.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/GL.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Shaders/GenericGL.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Instanced Phong shader for CompactInstanceData, with a single directional
+   light. Mirrors the subset of Shaders::PhongGL with VertexColor and
+   InstancedTransformation the playground uses, except that the instance
+   transformation is built from a translation, a uniform scale and a
+   quaternion in the vertex shader.
+
+   With Flag::InstanceTexture the instances are read from a texture instead
+   of attributes, at an offset given for each draw, which lets MeshBatch
+   draw different meshes with instances from a single buffer. */
+class CompactPhongGL : public GL::AbstractShaderProgram {
+ public:
+    enum class Flag : UnsignedByte {
+        /* Instances are read from a RGBA32UI texture two texels each, with
+           the CompactInstanceData layout. The texture is
+           InstanceTextureWidth texels wide. */
+        InstanceTexture = 1 << 0,
+
+        /* The draw index comes from gl_DrawID of ANGLE_multi_draw or
+           WEBGL_multi_draw instead of setDrawIndex(). Implies
+           InstanceTexture. */
+        MultiDraw = InstanceTexture | (1 << 1)
+    };
+    typedef Containers::EnumSet<Flag> Flags;
+
+    enum : UnsignedInt {
+        /* The largest texture size WebGL 2 and OpenGL ES 3.0 guarantee */
+        InstanceTextureWidth = 2048,
+        /* Most draws in a single multi-draw */
+        MaxDraws = 16
+    };
+
+    typedef Shaders::GenericGL3D::Position Position;
+    typedef Shaders::GenericGL3D::Normal Normal;
+
+    /* Translation in XYZ and uniform scale in W. The locations are the ones
+       of Shaders::GenericGL3D::TransformationMatrix, which this shader
+       doesn't use. */
+    typedef GL::Attribute<8, Vector4> InstanceTranslationScale;
+    /* Quaternion, meant to be stored as normalized Short */
+    typedef GL::Attribute<9, Vector4> InstanceRotation;
+    /* Meant to be stored as normalized UnsignedByte */
+    typedef GL::Attribute<10, Vector4> InstanceColor;
+
+    explicit CompactPhongGL(Flags flags = {});
+    explicit CompactPhongGL(NoCreateT) noexcept
+        : GL::AbstractShaderProgram{NoCreate} {}
+
+    /* Adds the instance attributes matching the CompactInstanceData layout
+       to given mesh */
+    static void addInstanceBuffer(GL::Mesh &mesh, GL::Buffer &buffer,
+                                  GLintptr offset);
+
+    CompactPhongGL &setProjectionMatrix(const Matrix4 &matrix);
+    /* Applied on top of the per-instance transformation, usually the camera
+       matrix */
+    CompactPhongGL &setTransformationMatrix(const Matrix4 &matrix);
+    CompactPhongGL &setNormalMatrix(const Matrix3x3 &matrix);
+
+    /* In the same space as the transformation matrix, pointing towards the
+       light */
+    CompactPhongGL &setLightDirection(const Vector3 &direction);
+    CompactPhongGL &setAmbientColor(const Color3 &color);
+    CompactPhongGL &setSpecularColor(const Color3 &color);
+    CompactPhongGL &setShininess(Float shininess);
+
+    Flags flags() const;
+
+    /* Offset of the first instance of each draw in the instance texture,
+       at most MaxDraws. Expects Flag::InstanceTexture. */
+    CompactPhongGL &
+    setInstanceOffsets(Containers::ArrayView<const UnsignedInt> offsets);
+
+    /* Index into the instance offsets for the next draw. Expects
+       Flag::InstanceTexture and not Flag::MultiDraw. */
+    CompactPhongGL &setDrawIndex(UnsignedInt index);
+
+    /* Expects Flag::InstanceTexture */
+    CompactPhongGL &bindInstanceTexture(GL::Texture2D &texture);
+
+    MAGNUM_GL_ABSTRACTSHADERPROGRAM_SUBCLASS_DRAW_IMPLEMENTATION(CompactPhongGL)
+
+ private:
+    Flags _flags;
+    Int _projectionMatrixUniform, _transformationMatrixUniform,
+        _normalMatrixUniform, _lightDirectionUniform, _ambientColorUniform,
+        _specularColorUniform, _shininessUniform, _instanceOffsetsUniform{-1},
+        _drawIndexUniform{-1};
+};
+
+CORRADE_ENUMSET_OPERATORS(CompactPhongGL::Flags)
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,90 @@
+#include "DebugWireframe.h"
+
+#include "FrustumCuller.h"
+#include "InstanceStore.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/Shaders/FlatGL.h>
+#include <Magnum/Trade/MeshData.h>
+
+namespace GraphicsPlayground {
+
+DebugWireframe::DebugWireframe(NoCreateT) noexcept {}
+
+DebugWireframe::DebugWireframe(const Trade::MeshData &meshData) {
+    CORRADE_ASSERT(meshData.primitive() == MeshPrimitive::Lines &&
+                       meshData.isIndexed(),
+                   "DebugWireframe: expected an indexed line mesh", );
+
+    _indices = GL::Buffer{GL::Buffer::TargetHint::ElementArray};
+    _indices.setData(meshData.indexData());
+    _vertices = GL::Buffer{};
+    _vertices.setData(meshData.vertexData());
+    _stream = InstanceStream{};
+    for (std::size_t slot = 0; slot != InstanceStream::SlotCount; ++slot) {
+        _meshes[slot] = MeshTools::compile(meshData, _indices, _vertices);
+        _meshes[slot].addVertexBufferInstanced(
+            _stream.buffer(slot), 1, 0,
+            Shaders::FlatGL3D::TransformationMatrix{});
+    }
+
+    for (const Vector3 &position : meshData.positions3DAsArray())
+        _boundingRadius = Math::max(_boundingRadius, position.length());
+}
+
+void DebugWireframe::draw(Shaders::FlatGL3D &shader,
+                          const InstanceStore &store, const View &view) {
+    const Containers::ArrayView<const Vector3> translations =
+        store.translations();
+    const Containers::ArrayView<const Quaternion> rotations =
+        store.rotations();
+    const Containers::ArrayView<const Float> scales = store.scales();
+
+    arrayResize(_visible, 0);
+    if (view.culler) {
+        view.culler->cull(translations, scales, _boundingRadius, 0,
+                          _visible);
+    } else {
+        for (std::size_t i = 0; i != store.size(); ++i)
+            arrayAppend(_visible, UnsignedInt(i));
+    }
+
+    /* Filtered in place, the kept ones are never ahead of the tested one */
+    if (view.radius > 0.0f) {
+        const Float radiusSquared = view.radius * view.radius;
+        std::size_t count = 0;
+        for (std::size_t i = 0; i != _visible.size(); ++i)
+            if ((translations[_visible[i]] - view.cameraPosition).dot() <
+                radiusSquared)
+                _visible[count++] = _visible[i];
+        arrayResize(_visible, count);
+    }
+
+    /* Same transformation as InstanceStore::fillInstanceData(), without
+       the normal matrix and color the lines don't need */
+    arrayResize(_transformations, NoInit, _visible.size());
+    for (std::size_t i = 0; i != _visible.size(); ++i) {
+        const UnsignedInt index = _visible[i];
+        _transformations[i] =
+            Matrix4::from(rotations[index].toMatrix() * scales[index],
+                          translations[index]);
+    }
+
+    _drawnCount = _transformations.size();
+    const std::size_t slot = _stream.upload(_transformations);
+    if (_transformations.isEmpty())
+        return;
+
+    GL::Mesh &mesh = _meshes[slot];
+    mesh.setInstanceCount(_transformations.size());
+    shader.draw(mesh);
+}
+
+std::size_t DebugWireframe::drawnCount() const {
+    return _drawnCount;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "InstanceStream.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Shaders/Shaders.h>
+#include <Magnum/Trade/Trade.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class FrustumCuller;
+class InstanceStore;
+
+/* Collision shapes of the instances of an InstanceStore drawn as a single
+   instanced line mesh, instead of Bullet's debug drawer generating every
+   line of every shape on the CPU each frame. The instances use the
+   transformations of the store, so the line mesh has to match the
+   collision shape at unit scale, the same way the solid mesh does. The
+   stores are only touched by the render thread, so unlike
+   btCollisionWorld::debugDrawWorld() this works while the simulation
+   thread runs. */
+class DebugWireframe {
+ public:
+    /* Which instances get drawn */
+    struct View {
+        /* Can be null */
+        const FrustumCuller *culler{};
+
+        /* Only instances with the center closer than given radius to the
+           camera position are drawn, all of them with zero radius */
+        Vector3 cameraPosition;
+        Float radius{};
+    };
+
+    explicit DebugWireframe(NoCreateT) noexcept;
+
+    /* Expects an indexed line mesh */
+    explicit DebugWireframe(const Trade::MeshData &meshData);
+
+    /* Uploads the transformations of the visible instances and draws them
+       with one draw call */
+    void draw(Shaders::FlatGL3D &shader, const InstanceStore &store,
+              const View &view = View{});
+
+    /* Instances drawn in the last draw() */
+    std::size_t drawnCount() const;
+
+ private:
+    GL::Buffer _indices{NoCreate}, _vertices{NoCreate};
+    InstanceStream _stream{NoCreate};
+    GL::Mesh _meshes[InstanceStream::SlotCount]{
+        GL::Mesh{NoCreate}, GL::Mesh{NoCreate}, GL::Mesh{NoCreate}};
+    Float _boundingRadius{};
+
+    /* Scratch space for culling and the transformations */
+    Containers::Array<UnsignedInt> _visible;
+    Containers::Array<Matrix4> _transformations;
+
+    std::size_t _drawnCount{};
+};
+
+}  // namespace GraphicsPlayground
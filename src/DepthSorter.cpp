@@ -0,0 +1,220 @@
+#include "DepthSorter.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+/* Insertion sort gives up after moving a quarter as many elements as
+   there are, as fixing up the order is mostly not cheaper than a radix
+   sort at that point */
+constexpr std::size_t MaxInsertionMovesDivisor = 4;
+
+/* Most frames to wait before trying the previous order again */
+constexpr UnsignedInt MaxBackoff = 15;
+
+constexpr std::size_t RadixBuckets = 256;
+
+}  // namespace
+
+void DepthSorter::sort(Containers::ArrayView<const Vector3> centers,
+                       const Vector3 &cameraPosition,
+                       const Vector3 &viewDirection,
+                       Containers::ArrayView<UnsignedInt> indices) {
+    const std::size_t count = indices.size();
+
+    /* After the incremental sort failed, the previous order isn't tried
+       again for a few frames, with the wait doubling on every failure */
+    arrayResize(_values, NoInit, count);
+    std::size_t reused = 0;
+    if (_skippedSorts) {
+        --_skippedSorts;
+        Utility::copy(indices, _values);
+    } else
+        reused = reusePrevious(centers, indices);
+
+    /* Depths quantized to the range between the nearest and the farthest
+       instance */
+    Float minDepth = Constants::inf(), maxDepth = -Constants::inf();
+    arrayResize(_depths, NoInit, count);
+    for (std::size_t i = 0; i != count; ++i) {
+        const Float depth =
+            Math::dot(centers[_values[i]] - cameraPosition, viewDirection);
+        _depths[i] = depth;
+        minDepth = Math::min(minDepth, depth);
+        maxDepth = Math::max(maxDepth, depth);
+    }
+    const Float scale =
+        maxDepth > minDepth ? 65535.0f / (maxDepth - minDepth) : 0.0f;
+    arrayResize(_keys, NoInit, count);
+    for (std::size_t i = 0; i != count; ++i)
+        _keys[i] = UnsignedShort((_depths[i] - minDepth) * scale);
+
+    /* The previous order gets fixed up by an insertion sort, the new
+       instances are sorted on their own and merged in. If the previous
+       order is too far off or most of the instances are new, everything is
+       radix sorted. */
+    const bool attempt = reused && 2 * reused >= count;
+    _lastSortIncremental =
+        attempt &&
+        insertionSort(0, reused, reused / MaxInsertionMovesDivisor);
+    if (_lastSortIncremental) {
+        radixSort(reused, count);
+        merge(reused);
+        _backoff = 0;
+    } else {
+        radixSort(0, count);
+        if (attempt) {
+            _backoff = Math::min(2 * _backoff + 1, MaxBackoff);
+            _skippedSorts = _backoff;
+        }
+    }
+
+    Utility::copy(_values, indices);
+    std::swap(_previous, _values);
+}
+
+std::size_t DepthSorter::reusePrevious(
+    Containers::ArrayView<const Vector3> centers,
+    Containers::ArrayView<const UnsignedInt> indices) {
+    /* Each sort uses two stamps, one for instances that are there and one
+       for instances already put in the new order. On wraparound all stamps
+       are reset. */
+    if (_stamp >= ~UnsignedInt{} - 2) {
+        std::fill(_stamps.begin(), _stamps.end(), 0u);
+        _stamp = 0;
+    }
+    _stamp += 2;
+    const UnsignedInt present = _stamp - 1, placed = _stamp;
+    for (const UnsignedInt index : indices) {
+        CORRADE_ASSERT(index < centers.size(),
+                       "DepthSorter::sort(): index" << index
+                           << "out of range for" << centers.size()
+                           << "centers",
+                       {});
+        if (index >= _stamps.size())
+            arrayResize(_stamps, ValueInit,
+                        Math::max(std::size_t(index) + 1,
+                                  2 * _stamps.size()));
+        _stamps[index] = present;
+    }
+
+    /* Instances from the previous sort first, in the order they were in,
+       then the new ones */
+    std::size_t reused = 0;
+    for (const UnsignedInt index : _previous) {
+        if (index < _stamps.size() && _stamps[index] == present) {
+            _stamps[index] = placed;
+            _values[reused++] = index;
+        }
+    }
+    std::size_t valueCount = reused;
+    for (const UnsignedInt index : indices) {
+        if (_stamps[index] == present) {
+            _stamps[index] = placed;
+            _values[valueCount++] = index;
+        }
+    }
+    CORRADE_ASSERT(valueCount == indices.size(),
+                   "DepthSorter::sort(): the indices are not unique", {});
+    return reused;
+}
+
+bool DepthSorter::insertionSort(const std::size_t begin,
+                                const std::size_t end,
+                                const std::size_t maxMoves) {
+    std::size_t moves = 0;
+    for (std::size_t i = begin + 1; i < end; ++i) {
+        const UnsignedShort key = _keys[i];
+        if (_keys[i - 1] <= key)
+            continue;
+
+        /* Stays a permutation even when giving up, the current element is
+           always put in place first */
+        const UnsignedInt value = _values[i];
+        std::size_t j = i;
+        for (; j != begin && _keys[j - 1] > key; --j) {
+            _keys[j] = _keys[j - 1];
+            _values[j] = _values[j - 1];
+        }
+        _keys[j] = key;
+        _values[j] = value;
+
+        moves += i - j;
+        if (moves > maxMoves)
+            return false;
+    }
+    return true;
+}
+
+void DepthSorter::radixSort(const std::size_t begin, const std::size_t end) {
+    if (end - begin < 2)
+        return;
+    arrayResize(_keysScratch, NoInit, _keys.size());
+    arrayResize(_valuesScratch, NoInit, _keys.size());
+
+    /* Histograms of both bytes in a single pass, turned into offsets */
+    std::size_t offsets[2][RadixBuckets]{};
+    for (std::size_t i = begin; i != end; ++i) {
+        ++offsets[0][_keys[i] & 0xff];
+        ++offsets[1][_keys[i] >> 8];
+    }
+    for (std::size_t(&pass)[RadixBuckets] : offsets) {
+        std::size_t sum = begin;
+        for (std::size_t &offset : pass) {
+            const std::size_t bucket = offset;
+            offset = sum;
+            sum += bucket;
+        }
+    }
+
+    /* Low byte into the scratch arrays and the high byte back, both
+       stable */
+    for (std::size_t i = begin; i != end; ++i) {
+        const std::size_t to = offsets[0][_keys[i] & 0xff]++;
+        _keysScratch[to] = _keys[i];
+        _valuesScratch[to] = _values[i];
+    }
+    for (std::size_t i = begin; i != end; ++i) {
+        const std::size_t to = offsets[1][_keysScratch[i] >> 8]++;
+        _keys[to] = _keysScratch[i];
+        _values[to] = _valuesScratch[i];
+    }
+}
+
+void DepthSorter::merge(const std::size_t middle) {
+    const std::size_t count = _keys.size();
+    if (middle == count)
+        return;
+    arrayResize(_keysScratch, NoInit, count);
+    arrayResize(_valuesScratch, NoInit, count);
+
+    std::size_t a = 0, b = middle;
+    for (std::size_t i = 0; i != count; ++i) {
+        const bool first = b == count || (a != middle && _keys[a] <= _keys[b]);
+        const std::size_t from = first ? a++ : b++;
+        _keysScratch[i] = _keys[from];
+        _valuesScratch[i] = _values[from];
+    }
+    std::swap(_keys, _keysScratch);
+    std::swap(_values, _valuesScratch);
+}
+
+bool DepthSorter::lastSortIncremental() const {
+    return _lastSortIncremental;
+}
+
+void DepthSorter::reset() {
+    arrayResize(_previous, 0);
+    _backoff = 0;
+    _skippedSorts = 0;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Orders instance indices front to back by their depth along the view
+   direction, so the nearest ones are drawn first and the depth test rejects
+   more of the fragments behind them.
+
+   Depths are quantized to 16-bit keys between the nearest and farthest
+   instance and sorted with a two-pass LSD radix sort. The order of the
+   previous sort is remembered, and if the same instances come in again,
+   they're put in that order first. As the camera and instances move only a
+   bit between frames, that's usually almost sorted already and gets
+   finished with an insertion sort, which falls back to the radix sort if it
+   has to move too much, in which case it's tried again only after a few
+   frames. Instances that weren't there in the previous sort
+   are radix sorted on their own and merged in. */
+class DepthSorter {
+ public:
+    /* Sorts the indices to given centers in place. The view direction is
+       expected to be normalized. */
+    void sort(Containers::ArrayView<const Vector3> centers,
+              const Vector3 &cameraPosition, const Vector3 &viewDirection,
+              Containers::ArrayView<UnsignedInt> indices);
+
+    /* Whether the last sort() was done incrementally from the previous
+       order */
+    bool lastSortIncremental() const;
+
+    /* Forgets the previous order, the next sort() is done from scratch */
+    void reset();
+
+ private:
+    /* Puts indices that were there in the previous sort to _values in
+       their previous order and the new ones after, returns how many were
+       there */
+    std::size_t reusePrevious(Containers::ArrayView<const Vector3> centers,
+                              Containers::ArrayView<const UnsignedInt> indices);
+
+    /* Insertion sort of a range of _keys and _values, gives up and returns
+       false once it moved more than given number of elements */
+    bool insertionSort(std::size_t begin, std::size_t end,
+                       std::size_t maxMoves);
+    void radixSort(std::size_t begin, std::size_t end);
+
+    /* Merges the sorted ranges before and after given position */
+    void merge(std::size_t middle);
+
+    /* Previous order and a stamp of each instance index seen in the
+       current sort, for finding which of them are still there */
+    Containers::Array<UnsignedInt> _previous;
+    Containers::Array<UnsignedInt> _stamps;
+    UnsignedInt _stamp{};
+
+    /* Depths, keys and indices being sorted, with scratch space for the
+       radix passes */
+    Containers::Array<Float> _depths;
+    Containers::Array<UnsignedShort> _keys, _keysScratch;
+    Containers::Array<UnsignedInt> _values, _valuesScratch;
+
+    bool _lastSortIncremental{};
+    /* Frames to wait after a failed incremental sort and how many of them
+       are left */
+    UnsignedInt _backoff{}, _skippedSorts{};
+};
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,91 @@
+#include "FrustumCuller.h"
+
+#include "Simd.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+FrustumCuller::FrustumCuller(const Matrix4 &projectionCameraMatrix) {
+    /* The planes from the matrix aren't normalized, which the distance to
+       a sphere center needs */
+    const Frustum frustum = Frustum::fromMatrix(projectionCameraMatrix);
+    for (std::size_t i = 0; i != 6; ++i)
+        _planes[i] = frustum[i] / frustum[i].xyz().length();
+}
+
+const Vector4 &FrustumCuller::plane(std::size_t i) const {
+    return _planes[i];
+}
+
+bool FrustumCuller::isVisible(const Vector3 &center, Float radius) const {
+    for (const Vector4 &plane : _planes)
+        if (Math::dot(plane.xyz(), center) + plane.w() < -radius)
+            return false;
+    return true;
+}
+
+std::size_t FrustumCuller::cull(Containers::ArrayView<const Vector3> centers,
+                                Containers::ArrayView<const Float> scales,
+                                Float radius, UnsignedInt offset,
+                                Containers::Array<UnsignedInt> &visible) const {
+    CORRADE_ASSERT(centers.size() == scales.size(),
+                   "FrustumCuller::cull(): expected"
+                       << centers.size() << "scales but got"
+                       << scales.size(),
+                   {});
+
+    Simd::Pack planes[6][4];
+    for (std::size_t i = 0; i != 6; ++i)
+        for (std::size_t j = 0; j != 4; ++j)
+            planes[i][j] = Simd::splat(_planes[i][j]);
+    const Simd::Pack zero = Simd::splat(0.0f);
+    const Simd::Pack sphereRadius = Simd::splat(radius);
+
+    /* The centers are interleaved, so each pack is transposed through the
+       stack first. Lanes past the end are masked out below. */
+    Float x[Simd::Width]{}, y[Simd::Width]{}, z[Simd::Width]{},
+        s[Simd::Width]{};
+    const std::size_t count = centers.size();
+    const std::size_t previousSize = visible.size();
+    for (std::size_t i = 0; i < count; i += Simd::Width) {
+        const std::size_t laneCount = Math::min(count - i, Simd::Width);
+        for (std::size_t j = 0; j != laneCount; ++j) {
+            x[j] = centers[i + j].x();
+            y[j] = centers[i + j].y();
+            z[j] = centers[i + j].z();
+            s[j] = scales[i + j];
+        }
+
+        const Simd::Pack px = Simd::load(x);
+        const Simd::Pack py = Simd::load(y);
+        const Simd::Pack pz = Simd::load(z);
+        const Simd::Pack r = Simd::mul(Simd::load(s), sphereRadius);
+
+        /* Inside if the signed distance is larger than minus the radius for
+           all planes */
+        Simd::Mask inside{};
+        for (std::size_t p = 0; p != 6; ++p) {
+            const Simd::Pack distance = Simd::add(
+                Simd::add(Simd::add(Simd::mul(planes[p][0], px),
+                                    Simd::mul(planes[p][1], py)),
+                          Simd::add(Simd::mul(planes[p][2], pz),
+                                    planes[p][3])),
+                r);
+            const Simd::Mask planeInside = Simd::greater(distance, zero);
+            inside = p ? Simd::both(inside, planeInside) : planeInside;
+        }
+
+        const Int bits = Simd::bits(inside);
+        for (std::size_t j = 0; j != laneCount; ++j)
+            if (bits & (1 << j))
+                arrayAppend(visible, offset + UnsignedInt(i + j));
+    }
+
+    return visible.size() - previousSize;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Vector4.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Tests bounding spheres against the six planes of a view frustum, several
+   spheres at a time using the Simd wrapper. A sphere is kept if it's not
+   completely outside of any plane, so a few spheres near the frustum
+   corners pass even though they aren't visible. */
+class FrustumCuller {
+ public:
+    /* Planes are extracted from the combined projection and camera
+       matrix, the spheres are then expected in world space */
+    explicit FrustumCuller(const Matrix4 &projectionCameraMatrix);
+
+    /* Normalized planes, with the normal pointing inside */
+    const Vector4 &plane(std::size_t i) const;
+
+    bool isVisible(const Vector3 &center, Float radius) const;
+
+    /* Appends indices of visible spheres, shifted by given offset. Radius
+       of each sphere is its scale multiplied by the radius parameter.
+       Returns the number of appended indices. */
+    std::size_t cull(Containers::ArrayView<const Vector3> centers,
+                     Containers::ArrayView<const Float> scales, Float radius,
+                     UnsignedInt offset,
+                     Containers::Array<UnsignedInt> &visible) const;
+
+ private:
+    Vector4 _planes[6];
+};
+
+}  // namespace GraphicsPlayground
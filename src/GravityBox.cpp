@@ -4,10 +4,21 @@
 
 namespace GraphicsPlayground {
 
+namespace {
+
+/* Squared length of a batch of vectors */
+Simd::Pack dot(Simd::Pack x, Simd::Pack y, Simd::Pack z) {
+    return Simd::add(Simd::add(Simd::mul(x, x), Simd::mul(y, y)),
+                     Simd::mul(z, z));
+}
+
+}  // namespace
+
 GravityBox::GravityBox(Float gravity, const Vector3 &boundaryDistance,
                        Float innerDistance, Float innerFalloffDistance,
-                       Float outerDistance, Float outerFalloffDistance)
-    : _gravity(gravity), _boundaryDistance(boundaryDistance),
+                       Float outerDistance, Float outerFalloffDistance,
+                       const Vector3 &center)
+    : _gravity(gravity), _center(center), _boundaryDistance(boundaryDistance),
       _innerDistance(innerDistance),
       _innerFalloffDistance(innerFalloffDistance),
       _outerDistance(outerDistance),
@@ -25,7 +36,13 @@ GravityBox::GravityBox(Float gravity, const Vector3 &boundaryDistance,
     _outerFalloffFactor = 1.0f / (_outerFalloffDistance - _outerDistance);
 }
 
-Vector3 GravityBox::getGravity(const Vector3 &position) {
+Range3D GravityBox::doBounds() const {
+    return Range3D::fromCenter(
+        _center, _boundaryDistance + Vector3{_outerFalloffDistance});
+}
+
+Vector3 GravityBox::doGravity(const Vector3 &worldPosition) const {
+    const Vector3 position = worldPosition - _center;
     Vector3 vector{};
 
     int outside = 0;
@@ -98,12 +115,94 @@ Float GravityBox::getGravityComponent(Float coordinate, Float distance) const {
     return coordinate > 0.0f ? -g : g;
 }
 
-Vector3 GravityBox::getGravity(const Vector3 &position, Vector3 *upAxis) {
-    Vector3 g = getGravity(position);
-    if (upAxis != nullptr) {
-        *upAxis = -g.normalized();
-    }
-    return g;
+void GravityBox::doGravityBatch(const ConstVector3Batch &positions,
+                                const Vector3Batch &gravity) const {
+    const Simd::Pack zero = Simd::splat(0.0f);
+    const Simd::Pack one = Simd::splat(1.0f);
+    const Simd::Pack gravityStrength = Simd::splat(_gravity);
+    const Simd::Pack cx = Simd::splat(_center.x());
+    const Simd::Pack cy = Simd::splat(_center.y());
+    const Simd::Pack cz = Simd::splat(_center.z());
+    const Simd::Pack bx = Simd::splat(_boundaryDistance.x());
+    const Simd::Pack by = Simd::splat(_boundaryDistance.y());
+    const Simd::Pack bz = Simd::splat(_boundaryDistance.z());
+    const Simd::Pack nbx = Simd::splat(-_boundaryDistance.x());
+    const Simd::Pack nby = Simd::splat(-_boundaryDistance.y());
+    const Simd::Pack nbz = Simd::splat(-_boundaryDistance.z());
+    const Simd::Pack innerDistance = Simd::splat(_innerDistance);
+    const Simd::Pack innerFalloffDistance = Simd::splat(_innerFalloffDistance);
+    const Simd::Pack innerFalloffFactor = Simd::splat(_innerFalloffFactor);
+    const Simd::Pack outerDistance = Simd::splat(_outerDistance);
+    const Simd::Pack outerFalloffDistance = Simd::splat(_outerFalloffDistance);
+    const Simd::Pack outerFalloffFactor = Simd::splat(_outerFalloffFactor);
+
+    /* Branchless version of doGravity(), both the outside and the inside case
+       are calculated for all lanes and the right one is picked at the end */
+    forEachPack(positions, gravity, [&](const Float *x, const Float *y,
+                                        const Float *z, Float *gx, Float *gy,
+                                        Float *gz) {
+        const Simd::Pack px = Simd::sub(Simd::load(x), cx);
+        const Simd::Pack py = Simd::sub(Simd::load(y), cy);
+        const Simd::Pack pz = Simd::sub(Simd::load(z), cz);
+
+        /* Outside: vector towards the closest point on the boundary, zero for
+           axes that are within it. If only one axis is outside, its length is
+           the same as the absolute value the scalar variant calculates. */
+        const Simd::Pack vx = Simd::sub(Simd::min(Simd::max(px, nbx), bx), px);
+        const Simd::Pack vy = Simd::sub(Simd::min(Simd::max(py, nby), by), py);
+        const Simd::Pack vz = Simd::sub(Simd::min(Simd::max(pz, nbz), bz), pz);
+        const Simd::Mask outside = Simd::either(
+            Simd::either(
+                Simd::either(Simd::greater(px, bx), Simd::less(px, nbx)),
+                Simd::either(Simd::greater(py, by), Simd::less(py, nby))),
+            Simd::either(Simd::greater(pz, bz), Simd::less(pz, nbz)));
+
+        const Simd::Pack distance = Simd::sqrt(dot(vx, vy, vz));
+        Simd::Pack g = Simd::div(gravityStrength, distance);
+        g = Simd::select(
+            Simd::greater(distance, outerDistance),
+            Simd::mul(g, Simd::sub(one, Simd::mul(Simd::sub(distance,
+                                                            outerDistance),
+                                                  outerFalloffFactor))),
+            g);
+        g = Simd::select(Simd::greater(distance, outerFalloffDistance), zero,
+                         g);
+
+        /* Inside: pulled towards the closest face, with the same tie breaking
+           as the scalar variant */
+        const Simd::Pack dx = Simd::sub(bx, Simd::abs(px));
+        const Simd::Pack dy = Simd::sub(by, Simd::abs(py));
+        const Simd::Pack dz = Simd::sub(bz, Simd::abs(pz));
+        const Simd::Mask closestX =
+            Simd::both(Simd::less(dx, dy), Simd::less(dx, dz));
+        const Simd::Mask closestY =
+            Simd::andNot(Simd::less(dy, dz), Simd::less(dx, dy));
+        const Simd::Mask closestXY = Simd::either(closestX, closestY);
+        const Simd::Pack d =
+            Simd::select(closestX, dx, Simd::select(closestY, dy, dz));
+        const Simd::Pack coordinate =
+            Simd::select(closestX, px, Simd::select(closestY, py, pz));
+
+        Simd::Pack c = gravityStrength;
+        c = Simd::select(
+            Simd::greater(d, innerDistance),
+            Simd::mul(c, Simd::sub(one, Simd::mul(Simd::sub(d, innerDistance),
+                                                  innerFalloffFactor))),
+            c);
+        c = Simd::select(Simd::greater(d, innerFalloffDistance), zero, c);
+        c = Simd::select(Simd::greater(coordinate, zero), Simd::sub(zero, c),
+                         c);
+
+        const Simd::Pack rx = Simd::select(outside, Simd::mul(g, vx),
+                                           Simd::select(closestX, c, zero));
+        const Simd::Pack ry = Simd::select(outside, Simd::mul(g, vy),
+                                           Simd::select(closestY, c, zero));
+        const Simd::Pack rz = Simd::select(outside, Simd::mul(g, vz),
+                                           Simd::select(closestXY, zero, c));
+        Simd::store(gx, rx);
+        Simd::store(gy, ry);
+        Simd::store(gz, rz);
+    });
 }
 
 }  // namespace GraphicsPlayground
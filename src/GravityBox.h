@@ -1,5 +1,7 @@
 #pragma once
 
+#include "GravityField.h"
+
 #include <Magnum/Magnum.h>
 #include <Magnum/Math/Vector3.h>
 
@@ -7,20 +9,29 @@ namespace GraphicsPlayground {
 
 using namespace Magnum;
 
-class GravityBox {
+/* Axis-aligned box pulling towards its faces from both the inside and the
+   outside */
+class GravityBox : public GravityField {
  public:
     GravityBox(Float gravity, const Vector3 &boundaryDistance,
                Float innerDistance, Float innerFalloffDistance,
-               Float outerDistance, Float outerFalloffDistance);
-
-    Vector3 getGravity(const Vector3 &position);
-    Vector3 getGravity(const Vector3 &position, Vector3 *upAxis);
+               Float outerDistance, Float outerFalloffDistance,
+               const Vector3 &center = {});
 
  private:
+    Range3D doBounds() const override;
+    Vector3 doGravity(const Vector3 &position) const override;
+
+    /* Vectorized with the widest SIMD instruction set the target is
+       compiled for */
+    void doGravityBatch(const ConstVector3Batch &positions,
+                        const Vector3Batch &gravity) const override;
+
     Float getGravityComponent(Float coordinate, Float distance) const;
 
     Float _gravity;
 
+    Vector3 _center;
     Vector3 _boundaryDistance;
     Float _innerDistance, _innerFalloffDistance;
     Float _outerDistance, _outerFalloffDistance;
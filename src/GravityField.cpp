@@ -0,0 +1,95 @@
+#include "GravityField.h"
+
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+GravityField::GravityField() = default;
+
+GravityField::~GravityField() = default;
+
+Int GravityField::priority() const {
+    return _priority;
+}
+
+GravityField &GravityField::setPriority(Int priority) {
+    _priority = priority;
+    return *this;
+}
+
+Range3D GravityField::bounds() const {
+    return doBounds();
+}
+
+bool GravityField::isBounded() const {
+    const Range3D range = doBounds();
+    return !Math::isInf(range.min()).any() && !Math::isInf(range.max()).any();
+}
+
+Vector3 GravityField::getGravity(const Vector3 &position) const {
+    return doGravity(position);
+}
+
+Vector3 GravityField::getGravity(const Vector3 &position,
+                                 Vector3 *upAxis) const {
+    Vector3 g = doGravity(position);
+    if (upAxis != nullptr) {
+        *upAxis = -g.normalized();
+    }
+    return g;
+}
+
+void GravityField::getGravity(const ConstVector3Batch &positions,
+                              const Vector3Batch &gravity) const {
+    const std::size_t count = positions.size();
+    CORRADE_ASSERT(positions.y.size() == count && positions.z.size() == count &&
+                       gravity.x.size() == count && gravity.y.size() == count &&
+                       gravity.z.size() == count,
+                   "GravityField::getGravity(): expected"
+                       << count << "items in all views", );
+
+    doGravityBatch(positions, gravity);
+}
+
+void GravityField::getGravity(const ConstVector3Batch &positions,
+                              const Vector3Batch &gravity,
+                              const Vector3Batch &upAxes) const {
+    const std::size_t count = positions.size();
+    CORRADE_ASSERT(upAxes.x.size() == count && upAxes.y.size() == count &&
+                       upAxes.z.size() == count,
+                   "GravityField::getGravity(): expected"
+                       << count << "items in all views", );
+
+    getGravity(positions, gravity);
+
+    /* Up axis is the negated normalized gravity. Zero gravity results in
+       NaNs, same as in the scalar variant. */
+    const Simd::Pack zero = Simd::splat(0.0f);
+    forEachPack(ConstVector3Batch{gravity.x, gravity.y, gravity.z}, upAxes,
+                [&](const Float *x, const Float *y, const Float *z, Float *ux,
+                    Float *uy, Float *uz) {
+                    const Simd::Pack gx = Simd::load(x);
+                    const Simd::Pack gy = Simd::load(y);
+                    const Simd::Pack gz = Simd::load(z);
+                    const Simd::Pack length = Simd::sqrt(Simd::add(
+                        Simd::add(Simd::mul(gx, gx), Simd::mul(gy, gy)),
+                        Simd::mul(gz, gz)));
+                    Simd::store(ux, Simd::div(Simd::sub(zero, gx), length));
+                    Simd::store(uy, Simd::div(Simd::sub(zero, gy), length));
+                    Simd::store(uz, Simd::div(Simd::sub(zero, gz), length));
+                });
+}
+
+void GravityField::doGravityBatch(const ConstVector3Batch &positions,
+                                  const Vector3Batch &gravity) const {
+    for (std::size_t i = 0; i != positions.size(); ++i) {
+        const Vector3 g = doGravity(
+            Vector3{positions.x[i], positions.y[i], positions.z[i]});
+        gravity.x[i] = g.x();
+        gravity.y[i] = g.y();
+        gravity.z[i] = g.z();
+    }
+}
+
+}  // namespace GraphicsPlayground
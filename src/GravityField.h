@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Simd.h"
+#include "Vector3Batch.h"
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Source of custom gravity, after the gravity sources of the Catlike Coding
+   custom gravity tutorial */
+class GravityField {
+ public:
+    GravityField();
+    virtual ~GravityField();
+
+    /* Fields with a higher priority override the ones with a lower priority
+       wherever they pull, fields with the same priority add up. Defaults to
+       0. */
+    Int priority() const;
+    GravityField &setPriority(Int priority);
+
+    /* Box outside of which the field has no effect, infinite if the field
+       is unbounded */
+    Range3D bounds() const;
+    bool isBounded() const;
+
+    Vector3 getGravity(const Vector3 &position) const;
+    Vector3 getGravity(const Vector3 &position, Vector3 *upAxis) const;
+
+    /* Batched variants of the above, the outputs are expected to have the
+       same size as the positions */
+    void getGravity(const ConstVector3Batch &positions,
+                    const Vector3Batch &gravity) const;
+    void getGravity(const ConstVector3Batch &positions,
+                    const Vector3Batch &gravity,
+                    const Vector3Batch &upAxes) const;
+
+ protected:
+    /* Calls kernel(x, y, z, gx, gy, gz) with pointers to Simd::Width items
+       at a time, the remainder goes through a zero-padded temporary */
+    template <class Kernel>
+    static void forEachPack(const ConstVector3Batch &positions,
+                            const Vector3Batch &gravity, Kernel &&kernel);
+
+ private:
+    virtual Range3D doBounds() const = 0;
+    virtual Vector3 doGravity(const Vector3 &position) const = 0;
+
+    /* Calls doGravity() for each position by default */
+    virtual void doGravityBatch(const ConstVector3Batch &positions,
+                                const Vector3Batch &gravity) const;
+
+    Int _priority{};
+};
+
+template <class Kernel>
+void GravityField::forEachPack(const ConstVector3Batch &positions,
+                               const Vector3Batch &gravity, Kernel &&kernel) {
+    const std::size_t count = positions.size();
+    std::size_t i = 0;
+    for (; i + Simd::Width <= count; i += Simd::Width) {
+        kernel(positions.x.data() + i, positions.y.data() + i,
+               positions.z.data() + i, gravity.x.data() + i,
+               gravity.y.data() + i, gravity.z.data() + i);
+    }
+
+    if (i == count)
+        return;
+
+    Float in[3][Simd::Width]{};
+    Float out[3][Simd::Width];
+    for (std::size_t j = i; j != count; ++j) {
+        in[0][j - i] = positions.x[j];
+        in[1][j - i] = positions.y[j];
+        in[2][j - i] = positions.z[j];
+    }
+
+    kernel(in[0], in[1], in[2], out[0], out[1], out[2]);
+
+    for (std::size_t j = i; j != count; ++j) {
+        gravity.x[j] = out[0][j - i];
+        gravity.y[j] = out[1][j - i];
+        gravity.z[j] = out[2][j - i];
+    }
+}
+
+}  // namespace GraphicsPlayground
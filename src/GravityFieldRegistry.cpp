@@ -0,0 +1,347 @@
+#include "GravityFieldRegistry.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Functions.h>
+
+#include <limits>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+/* Fields covering more cells than this are treated as unbounded, so huge
+   fields don't bloat the index */
+constexpr const Long MaxCellsPerField = 4096;
+
+/* Keeps cell coordinates in a sane range for far away or huge positions */
+constexpr const Float MaxCellCoordinate = 1.0e6f;
+
+Vector3i cellCoordinates(const Vector3 &position, Float cellSize) {
+    /* A NaN would get through the clamp and converting it to an integer is
+       undefined, it goes to cell 0 instead */
+    Vector3 coordinates = Math::floor(position / cellSize);
+    for (Int i = 0; i != 3; ++i)
+        if (Math::isNan(coordinates[i]))
+            coordinates[i] = 0.0f;
+    return Vector3i{
+        Math::clamp(coordinates, -MaxCellCoordinate, MaxCellCoordinate)};
+}
+
+UnsignedInt hashCell(const Vector3i &cell, UnsignedInt bucketCount) {
+    return ((UnsignedInt(cell.x()) * 73856093u) ^
+            (UnsignedInt(cell.y()) * 19349663u) ^
+            (UnsignedInt(cell.z()) * 83492791u)) &
+           (bucketCount - 1);
+}
+
+}  // namespace
+
+GravityFieldRegistry::GravityFieldRegistry(Float cellSize)
+    : _cellSize(cellSize) {}
+
+GravityFieldRegistry::~GravityFieldRegistry() = default;
+
+std::size_t GravityFieldRegistry::fieldCount() const {
+    return _fields.size();
+}
+
+GravityField &GravityFieldRegistry::field(std::size_t id) {
+    return *_fields[id];
+}
+
+GravityField &
+GravityFieldRegistry::add(Containers::Pointer<GravityField> field) {
+    GravityField &out = *field;
+    markChanged(out);
+    arrayAppend(_fields, std::move(field));
+    rebuildIndex();
+    return out;
+}
+
+void GravityFieldRegistry::remove(GravityField &field) {
+    for (std::size_t i = 0; i != _fields.size(); ++i) {
+        if (_fields[i].get() != &field)
+            continue;
+
+        markChanged(field);
+        arrayRemoveUnordered(_fields, i);
+        rebuildIndex();
+        return;
+    }
+}
+
+void GravityFieldRegistry::update(GravityField &field) {
+    for (std::size_t i = 0; i != _fields.size(); ++i) {
+        if (_fields[i].get() != &field)
+            continue;
+
+        /* Where the field pulled until now, as it was last indexed */
+        markChanged(_bounds[i]);
+        markChanged(field);
+        rebuildIndex();
+        return;
+    }
+}
+
+std::size_t GravityFieldRegistry::unboundedFieldCount() const {
+    return _unboundedFields.size();
+}
+
+Containers::Optional<Range3D> GravityFieldRegistry::takeChangedBounds() {
+    Containers::Optional<Range3D> out = _changedBounds;
+    _changedBounds = Containers::NullOpt;
+    return out;
+}
+
+void GravityFieldRegistry::markChanged(const GravityField &field) {
+    markChanged(field.isBounded() ? field.bounds()
+                                  : Range3D{Vector3{-Constants::inf()},
+                                            Vector3{Constants::inf()}});
+}
+
+void GravityFieldRegistry::markChanged(const Range3D &bounds) {
+    _changedBounds =
+        _changedBounds ? Math::join(*_changedBounds, bounds) : bounds;
+}
+
+void GravityFieldRegistry::rebuildIndex() {
+    arrayResize(_bounds, NoInit, _fields.size());
+    arrayResize(_unboundedFields, 0);
+
+    /* Classify the fields and count the cell references to size the hash
+       table */
+    Long cellReferences = 0;
+    for (std::size_t i = 0; i != _fields.size(); ++i) {
+        _bounds[i] = _fields[i]->bounds();
+        Long cells = MaxCellsPerField + 1;
+        if (_fields[i]->isBounded()) {
+            const Vector3i size =
+                cellCoordinates(_bounds[i].max(), _cellSize) -
+                cellCoordinates(_bounds[i].min(), _cellSize) + Vector3i{1};
+            cells = Long(size.x()) * size.y() * size.z();
+        }
+
+        if (cells > MaxCellsPerField)
+            arrayAppend(_unboundedFields, UnsignedInt(i));
+        else
+            cellReferences += cells;
+    }
+
+    UnsignedInt bucketCount = 64;
+    while (bucketCount < 2 * cellReferences)
+        bucketCount *= 2;
+
+    /* Two passes over the cells of each field, first counting and then
+       filling. Several cells of the same field can hash to the same bucket,
+       those are written just once, which lastField keeps track of. */
+    arrayResize(_bucketOffsets, NoInit, bucketCount + 1);
+    for (UnsignedInt &offset : _bucketOffsets)
+        offset = 0;
+    Containers::Array<UnsignedInt> lastField{NoInit, bucketCount};
+    Containers::Array<UnsignedInt> cursors{NoInit, bucketCount};
+    for (Int pass = 0; pass != 2; ++pass) {
+        for (UnsignedInt &field : lastField)
+            field = ~UnsignedInt{};
+
+        std::size_t u = 0;
+        for (std::size_t i = 0; i != _fields.size(); ++i) {
+            if (u != _unboundedFields.size() && _unboundedFields[u] == i) {
+                ++u;
+                continue;
+            }
+
+            const Vector3i min = cellCoordinates(_bounds[i].min(), _cellSize);
+            const Vector3i max = cellCoordinates(_bounds[i].max(), _cellSize);
+            for (Int z = min.z(); z <= max.z(); ++z) {
+                for (Int y = min.y(); y <= max.y(); ++y) {
+                    for (Int x = min.x(); x <= max.x(); ++x) {
+                        const UnsignedInt b = hashCell({x, y, z}, bucketCount);
+                        if (lastField[b] == i)
+                            continue;
+                        lastField[b] = UnsignedInt(i);
+
+                        if (pass == 0)
+                            ++_bucketOffsets[b + 1];
+                        else
+                            _bucketFields[cursors[b]++] = UnsignedInt(i);
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (UnsignedInt b = 0; b != bucketCount; ++b) {
+                _bucketOffsets[b + 1] += _bucketOffsets[b];
+                cursors[b] = _bucketOffsets[b];
+            }
+            arrayResize(_bucketFields, NoInit, _bucketOffsets[bucketCount]);
+        }
+    }
+}
+
+UnsignedInt GravityFieldRegistry::bucket(const Vector3 &position) const {
+    return hashCell(cellCoordinates(position, _cellSize),
+                    UnsignedInt(_bucketOffsets.size() - 1));
+}
+
+Range3D GravityFieldRegistry::doBounds() const {
+    if (_fields.isEmpty())
+        return {};
+
+    Range3D bounds = _bounds[0];
+    for (const Range3D &fieldBounds : _bounds)
+        bounds = Math::join(bounds, fieldBounds);
+    return bounds;
+}
+
+Vector3 GravityFieldRegistry::doGravity(const Vector3 &position) const {
+    Vector3 gravity;
+    Int priority = std::numeric_limits<Int>::min();
+
+    auto accumulate = [&](UnsignedInt id) {
+        const Vector3 g = _fields[id]->getGravity(position);
+        if (g.dot() == 0.0f)
+            return;
+
+        const Int fieldPriority = _fields[id]->priority();
+        if (fieldPriority > priority) {
+            priority = fieldPriority;
+            gravity = g;
+        } else if (fieldPriority == priority) {
+            gravity += g;
+        }
+    };
+
+    for (UnsignedInt id : _unboundedFields)
+        accumulate(id);
+
+    if (_bucketOffsets.isEmpty())
+        return gravity;
+
+    const UnsignedInt b = bucket(position);
+    for (UnsignedInt i = _bucketOffsets[b]; i != _bucketOffsets[b + 1]; ++i) {
+        const UnsignedInt id = _bucketFields[i];
+        if (_bounds[id].contains(position))
+            accumulate(id);
+    }
+
+    return gravity;
+}
+
+void GravityFieldRegistry::doGravityBatch(const ConstVector3Batch &positions,
+                                          const Vector3Batch &gravity) const {
+    const std::size_t count = positions.size();
+    const std::size_t fieldCount = _fields.size();
+
+    arrayResize(_priorities, NoInit, count);
+    for (std::size_t i = 0; i != count; ++i) {
+        gravity.x[i] = gravity.y[i] = gravity.z[i] = 0.0f;
+        _priorities[i] = std::numeric_limits<Int>::min();
+    }
+
+    if (!fieldCount)
+        return;
+
+    /* Replaces or adds to the gravity at given position based on the field
+       priority, same as in doGravity() */
+    auto merge = [&](std::size_t i, Int priority, Float x, Float y, Float z) {
+        if (x == 0.0f && y == 0.0f && z == 0.0f)
+            return;
+
+        if (priority > _priorities[i]) {
+            _priorities[i] = priority;
+            gravity.x[i] = x;
+            gravity.y[i] = y;
+            gravity.z[i] = z;
+        } else if (priority == _priorities[i]) {
+            gravity.x[i] += x;
+            gravity.y[i] += y;
+            gravity.z[i] += z;
+        }
+    };
+
+    arrayResize(_scratch, NoInit, 6 * count);
+    const Vector3Batch in{_scratch.slice(0, count),
+                          _scratch.slice(count, 2 * count),
+                          _scratch.slice(2 * count, 3 * count)};
+    const Vector3Batch out{_scratch.slice(3 * count, 4 * count),
+                           _scratch.slice(4 * count, 5 * count),
+                           _scratch.slice(5 * count, 6 * count)};
+
+    /* Unbounded fields affect all positions */
+    for (UnsignedInt id : _unboundedFields) {
+        _fields[id]->getGravity(positions, out);
+        for (std::size_t i = 0; i != count; ++i)
+            merge(i, _fields[id]->priority(), out.x[i], out.y[i], out.z[i]);
+    }
+
+    if (_bucketFields.isEmpty())
+        return;
+
+    /* Distribute the positions among the bounded fields containing them,
+       again in two passes */
+    arrayResize(_positionBuckets, NoInit, count);
+    arrayResize(_workOffsets, NoInit, fieldCount + 1);
+    arrayResize(_workCursors, NoInit, fieldCount);
+    for (UnsignedInt &offset : _workOffsets)
+        offset = 0;
+
+    for (std::size_t i = 0; i != count; ++i)
+        _positionBuckets[i] =
+            bucket({positions.x[i], positions.y[i], positions.z[i]});
+
+    for (Int pass = 0; pass != 2; ++pass) {
+        for (std::size_t i = 0; i != count; ++i) {
+            const Vector3 position{positions.x[i], positions.y[i],
+                                   positions.z[i]};
+            const UnsignedInt b = _positionBuckets[i];
+            for (UnsignedInt j = _bucketOffsets[b]; j != _bucketOffsets[b + 1];
+                 ++j) {
+                const UnsignedInt id = _bucketFields[j];
+                if (!_bounds[id].contains(position))
+                    continue;
+
+                if (pass == 0)
+                    ++_workOffsets[id + 1];
+                else
+                    _work[_workCursors[id]++] = UnsignedInt(i);
+            }
+        }
+
+        if (pass == 0) {
+            for (std::size_t id = 0; id != fieldCount; ++id) {
+                _workOffsets[id + 1] += _workOffsets[id];
+                _workCursors[id] = _workOffsets[id];
+            }
+            arrayResize(_work, NoInit, _workOffsets[fieldCount]);
+        }
+    }
+
+    /* Evaluate each field for its positions in a single batch */
+    for (std::size_t id = 0; id != fieldCount; ++id) {
+        const std::size_t begin = _workOffsets[id];
+        const std::size_t size = _workOffsets[id + 1] - begin;
+        if (!size)
+            continue;
+
+        for (std::size_t j = 0; j != size; ++j) {
+            const UnsignedInt i = _work[begin + j];
+            in.x[j] = positions.x[i];
+            in.y[j] = positions.y[i];
+            in.z[j] = positions.z[i];
+        }
+
+        _fields[id]->getGravity(
+            ConstVector3Batch{in.x.prefix(size), in.y.prefix(size),
+                              in.z.prefix(size)},
+            Vector3Batch{out.x.prefix(size), out.y.prefix(size),
+                         out.z.prefix(size)});
+
+        const Int priority = _fields[id]->priority();
+        for (std::size_t j = 0; j != size; ++j)
+            merge(_work[begin + j], priority, out.x[j], out.y[j], out.z[j]);
+    }
+}
+
+}  // namespace GraphicsPlayground
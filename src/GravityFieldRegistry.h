@@ -0,0 +1,90 @@
+#pragma once
+
+#include "GravityField.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Math/Vector3.h>
+
+#include <utility>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Set of gravity fields combined by their priority. Bounded fields are
+   indexed in a hashed uniform grid, so a query only evaluates the fields
+   whose bounds overlap the cell the position falls into, unbounded ones are
+   evaluated everywhere. Batched queries gather the positions affected by
+   each field and evaluate them with the batched variant of the field.
+
+   The batched query reuses internal scratch memory, so it's not safe to
+   call from multiple threads at once. */
+class GravityFieldRegistry : public GravityField {
+ public:
+    explicit GravityFieldRegistry(Float cellSize = 8.0f);
+    ~GravityFieldRegistry() override;
+
+    std::size_t fieldCount() const;
+    GravityField &field(std::size_t id);
+
+    /* Takes ownership of the field */
+    GravityField &add(Containers::Pointer<GravityField> field);
+
+    template <class T, class... Args>
+    T &emplace(Args &&...args) {
+        return static_cast<T &>(
+            add(Containers::pointer<T>(std::forward<Args>(args)...)));
+    }
+
+    /* Removes and destroys the field */
+    void remove(GravityField &field);
+
+    /* Has to be called after changing the priority or the parameters of a
+       field in the registry, otherwise queries keep using its old bounds
+       and bodies sleeping in the field aren't woken up. Reindexes the
+       field and marks both its old and new bounds as changed. */
+    void update(GravityField &field);
+
+    /* Number of fields evaluated everywhere */
+    std::size_t unboundedFieldCount() const;
+
+    /* Union of the bounds of all fields added or removed since the last
+       call, infinite if any of them was unbounded. NullOpt if there were
+       no changes. Used to wake bodies that sleep where the gravity
+       changed. */
+    Containers::Optional<Range3D> takeChangedBounds();
+
+ private:
+    void markChanged(const GravityField &field);
+    void markChanged(const Range3D &bounds);
+
+    Range3D doBounds() const override;
+    Vector3 doGravity(const Vector3 &position) const override;
+    void doGravityBatch(const ConstVector3Batch &positions,
+                        const Vector3Batch &gravity) const override;
+
+    void rebuildIndex();
+    UnsignedInt bucket(const Vector3 &position) const;
+
+    Float _cellSize;
+    Containers::Array<Containers::Pointer<GravityField>> _fields;
+    Containers::Optional<Range3D> _changedBounds;
+    Containers::Array<Range3D> _bounds;
+
+    /* Bounded fields overlapping each bucket are _bucketFields[
+       _bucketOffsets[i]] to _bucketFields[_bucketOffsets[i + 1]], bucket
+       count is always a power of two */
+    Containers::Array<UnsignedInt> _unboundedFields;
+    Containers::Array<UnsignedInt> _bucketOffsets;
+    Containers::Array<UnsignedInt> _bucketFields;
+
+    /* Scratch memory for batched queries */
+    mutable Containers::Array<UnsignedInt> _positionBuckets;
+    mutable Containers::Array<UnsignedInt> _workOffsets, _workCursors, _work;
+    mutable Containers::Array<Int> _priorities;
+    mutable Containers::Array<Float> _scratch;
+};
+
+}  // namespace GraphicsPlayground
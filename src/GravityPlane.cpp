@@ -0,0 +1,29 @@
+#include "GravityPlane.h"
+
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+GravityPlane::GravityPlane(Float gravity, Float range, const Vector3 &point,
+                           const Vector3 &normal)
+    : _gravity(gravity), _range(Math::max(range, 0.0f)), _point(point),
+      _normal(normal.normalized()) {}
+
+Range3D GravityPlane::doBounds() const {
+    return {Vector3{-Constants::inf()}, Vector3{Constants::inf()}};
+}
+
+Vector3 GravityPlane::doGravity(const Vector3 &position) const {
+    Float distance = Math::dot(_normal, position - _point);
+    if (distance > _range) {
+        return Vector3{};
+    }
+    Float g = -_gravity;
+    if (distance > 0.0f) {
+        g *= 1.0f - distance / _range;
+    }
+    return g * _normal;
+}
+
+}  // namespace GraphicsPlayground
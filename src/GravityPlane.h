@@ -0,0 +1,28 @@
+#pragma once
+
+#include "GravityField.h"
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Infinite plane pulling along its negated normal, fading out linearly up
+   to range above the plane. Everything below the plane gets the full
+   gravity, so the field is unbounded. */
+class GravityPlane : public GravityField {
+ public:
+    GravityPlane(Float gravity, Float range, const Vector3 &point = {},
+                 const Vector3 &normal = Vector3::yAxis());
+
+ private:
+    Range3D doBounds() const override;
+    Vector3 doGravity(const Vector3 &position) const override;
+
+    Float _gravity, _range;
+    Vector3 _point, _normal;
+};
+
+}  // namespace GraphicsPlayground
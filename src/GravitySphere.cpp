@@ -0,0 +1,89 @@
+#include "GravitySphere.h"
+
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+GravitySphere::GravitySphere(Float gravity, Float outerRadius,
+                             Float outerFalloffRadius, Float innerFalloffRadius,
+                             Float innerRadius, const Vector3 &center)
+    : _gravity(gravity), _center(center), _outerRadius(outerRadius),
+      _outerFalloffRadius(outerFalloffRadius), _innerRadius(innerRadius),
+      _innerFalloffRadius(innerFalloffRadius) {
+    _innerFalloffRadius = Math::max(_innerFalloffRadius, 0.0f);
+    _innerRadius = Math::max(_innerRadius, _innerFalloffRadius);
+    _outerRadius = Math::max(_outerRadius, _innerRadius);
+    _outerFalloffRadius = Math::max(_outerFalloffRadius, _outerRadius);
+
+    _innerFalloffFactor = 1.0f / (_innerRadius - _innerFalloffRadius);
+    _outerFalloffFactor = 1.0f / (_outerFalloffRadius - _outerRadius);
+}
+
+Range3D GravitySphere::doBounds() const {
+    return Range3D::fromCenter(_center, Vector3{_outerFalloffRadius});
+}
+
+Vector3 GravitySphere::doGravity(const Vector3 &position) const {
+    Vector3 vector = _center - position;
+    Float distance = vector.length();
+    if (distance > _outerFalloffRadius || distance < _innerFalloffRadius) {
+        return Vector3{};
+    }
+    Float g = _gravity / distance;
+    if (distance > _outerRadius) {
+        g *= 1.0f - (distance - _outerRadius) * _outerFalloffFactor;
+    } else if (distance < _innerRadius) {
+        g *= 1.0f - (_innerRadius - distance) * _innerFalloffFactor;
+    }
+    return g * vector;
+}
+
+void GravitySphere::doGravityBatch(const ConstVector3Batch &positions,
+                                   const Vector3Batch &gravity) const {
+    const Simd::Pack zero = Simd::splat(0.0f);
+    const Simd::Pack one = Simd::splat(1.0f);
+    const Simd::Pack gravityStrength = Simd::splat(_gravity);
+    const Simd::Pack cx = Simd::splat(_center.x());
+    const Simd::Pack cy = Simd::splat(_center.y());
+    const Simd::Pack cz = Simd::splat(_center.z());
+    const Simd::Pack outerRadius = Simd::splat(_outerRadius);
+    const Simd::Pack outerFalloffRadius = Simd::splat(_outerFalloffRadius);
+    const Simd::Pack outerFalloffFactor = Simd::splat(_outerFalloffFactor);
+    const Simd::Pack innerRadius = Simd::splat(_innerRadius);
+    const Simd::Pack innerFalloffRadius = Simd::splat(_innerFalloffRadius);
+    const Simd::Pack innerFalloffFactor = Simd::splat(_innerFalloffFactor);
+
+    forEachPack(positions, gravity, [&](const Float *x, const Float *y,
+                                        const Float *z, Float *gx, Float *gy,
+                                        Float *gz) {
+        const Simd::Pack vx = Simd::sub(cx, Simd::load(x));
+        const Simd::Pack vy = Simd::sub(cy, Simd::load(y));
+        const Simd::Pack vz = Simd::sub(cz, Simd::load(z));
+        const Simd::Pack distance = Simd::sqrt(
+            Simd::add(Simd::add(Simd::mul(vx, vx), Simd::mul(vy, vy)),
+                      Simd::mul(vz, vz)));
+
+        const Simd::Pack g = Simd::div(gravityStrength, distance);
+        const Simd::Pack outerFalloff =
+            Simd::sub(one, Simd::mul(Simd::sub(distance, outerRadius),
+                                     outerFalloffFactor));
+        const Simd::Pack innerFalloff =
+            Simd::sub(one, Simd::mul(Simd::sub(innerRadius, distance),
+                                     innerFalloffFactor));
+        Simd::Pack falloff =
+            Simd::select(Simd::greater(distance, outerRadius), outerFalloff,
+                         Simd::select(Simd::less(distance, innerRadius),
+                                      innerFalloff, one));
+        falloff = Simd::select(
+            Simd::either(Simd::greater(distance, outerFalloffRadius),
+                         Simd::less(distance, innerFalloffRadius)),
+            zero, falloff);
+
+        const Simd::Pack scale = Simd::mul(g, falloff);
+        Simd::store(gx, Simd::mul(scale, vx));
+        Simd::store(gy, Simd::mul(scale, vy));
+        Simd::store(gz, Simd::mul(scale, vz));
+    });
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "GravityField.h"
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Sphere pulling towards its center, fading out towards both the outer and
+   the inner falloff radius. With a negative gravity it pushes away from the
+   center instead, making it an inverted shell that can be walked on from
+   the inside. */
+class GravitySphere : public GravityField {
+ public:
+    GravitySphere(Float gravity, Float outerRadius, Float outerFalloffRadius,
+                  Float innerFalloffRadius, Float innerRadius,
+                  const Vector3 &center = {});
+
+ private:
+    Range3D doBounds() const override;
+    Vector3 doGravity(const Vector3 &position) const override;
+    void doGravityBatch(const ConstVector3Batch &positions,
+                        const Vector3Batch &gravity) const override;
+
+    Float _gravity;
+
+    Vector3 _center;
+    Float _outerRadius, _outerFalloffRadius;
+    Float _innerRadius, _innerFalloffRadius;
+
+    Float _outerFalloffFactor, _innerFalloffFactor;
+};
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,96 @@
+#include "GravitySystem.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/BulletIntegration/Integration.h>
+#include <Magnum/Math/Constants.h>
+
+namespace GraphicsPlayground {
+
+GravitySystem::GravitySystem(btDiscreteDynamicsWorld &bWorld,
+                             const GravityField &field)
+    : _bWorld(bWorld), _field(&field) {}
+
+const GravityField &GravitySystem::field() const {
+    return *_field;
+}
+
+void GravitySystem::setField(const GravityField &field) {
+    _field = &field;
+    wake(Range3D{Vector3{-Constants::inf()}, Vector3{Constants::inf()}});
+}
+
+void GravitySystem::wake(const Range3D &region) {
+    btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    for (Int i = 0; i != bodies.size(); ++i) {
+        btRigidBody *body = bodies[i];
+        if (body->getActivationState() == ISLAND_SLEEPING &&
+            region.contains(Vector3{body->getCenterOfMassPosition()}))
+            body->activate();
+    }
+}
+
+void GravitySystem::beginStep() {
+    /* btDiscreteDynamicsWorld::stepSimulation() adds the gravity of each
+       active body to its total force once before all substeps and clears
+       the forces after. Bodies woken up in between don't get it. */
+    const btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    arrayResize(_hasGravityForce, NoInit, bodies.size());
+    for (Int i = 0; i != bodies.size(); ++i)
+        _hasGravityForce[i] =
+            bodies[i]->isActive() && !bodies[i]->isStaticOrKinematicObject();
+}
+
+void GravitySystem::apply() {
+    /* Gather positions of all bodies gravity applies to */
+    btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    CORRADE_ASSERT(_hasGravityForce.size() == std::size_t(bodies.size()),
+                   "GravitySystem::apply(): beginStep() wasn't called with "
+                   "the same bodies", );
+    arrayResize(_indices, NoInit, bodies.size());
+    std::size_t count = 0;
+    for (Int i = 0; i != bodies.size(); ++i) {
+        btRigidBody *body = bodies[i];
+        if (body->isActive() && !body->isStaticOrKinematicObject())
+            _indices[count++] = UnsignedInt(i);
+    }
+
+    arrayResize(_data, NoInit, 6 * count);
+    const Vector3Batch positions{_data.slice(0, count),
+                                 _data.slice(count, 2 * count),
+                                 _data.slice(2 * count, 3 * count)};
+    const Vector3Batch gravity{_data.slice(3 * count, 4 * count),
+                               _data.slice(4 * count, 5 * count),
+                               _data.slice(5 * count, 6 * count)};
+    for (std::size_t i = 0; i != count; ++i) {
+        const btVector3 &position =
+            bodies[_indices[i]]->getCenterOfMassPosition();
+        positions.x[i] = position.x();
+        positions.y[i] = position.y();
+        positions.z[i] = position.z();
+    }
+
+    _field->getGravity(
+        ConstVector3Batch{positions.x, positions.y, positions.z}, gravity);
+
+    /* As the gravity force is added only once per step, just calling
+       setGravity() wouldn't have any effect until the next step. Instead,
+       swap the force of the previous gravity for the new one, or add the
+       whole force to bodies that woke up during the step. */
+    for (std::size_t i = 0; i != count; ++i) {
+        btRigidBody *body = bodies[_indices[i]];
+        const btVector3 g{gravity.x[i], gravity.y[i], gravity.z[i]};
+        if (_hasGravityForce[_indices[i]])
+            body->applyCentralForce((g - body->getGravity()) *
+                                    body->getMass());
+        else
+            body->applyCentralForce(g * body->getMass());
+        body->setGravity(g);
+        _hasGravityForce[_indices[i]] = true;
+    }
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GravityField.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Math/Range.h>
+#include <btBulletDynamicsCommon.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Applies the gravity of a GravityField to all active dynamic bodies of a
+   world. Meant to be called at the start of every internal Bullet step, so
+   gravity stays in sync with the body positions even if the world takes
+   several substeps per frame.
+
+   Sleeping bodies keep the gravity they had when they fell asleep, so
+   they have to be woken up with wake() when the field changes around them.
+   Bullet then wakes the rest of their island. */
+class GravitySystem {
+ public:
+    GravitySystem(btDiscreteDynamicsWorld &bWorld, const GravityField &field);
+
+    /* The field is expected to outlive the system. Setting it wakes all
+       bodies. */
+    const GravityField &field() const;
+    void setField(const GravityField &field);
+
+    /* Has to be called right before every btDiscreteDynamicsWorld::
+       stepSimulation(), without adding or removing bodies until it
+       returns */
+    void beginStep();
+
+    void apply();
+
+    /* Wakes sleeping dynamic bodies with the center in given region */
+    void wake(const Range3D &region);
+
+ private:
+    btDiscreteDynamicsWorld &_bWorld;
+    const GravityField *_field;
+
+    /* Whether the total force of each non-static body, in the order of
+       the world, contains the force of its current gravity */
+    Containers::Array<bool> _hasGravityForce;
+
+    /* Scratch memory, kept between steps to avoid allocations */
+    Containers::Array<UnsignedInt> _indices;
+    Containers::Array<Float> _data;
+};
+
+}  // namespace GraphicsPlayground
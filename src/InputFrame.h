@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Everything the simulation gets from the user in a frame. The application
+   runs every frame on the main thread through Simulation::runFrame() with
+   one, so a session can be replayed from the frames alone. Stored as is in
+   an InputRecording. */
+struct InputFrame {
+    /* Duration of the frame in seconds and the tick rate during it */
+    Float duration;
+    Float tickRate;
+
+    /* Axes of the space the ball input is in, usually of the camera. The
+       ball controls don't use anything else from it. */
+    Vector3 inputRight, inputBackward;
+
+    /* Ball input along the X and Z axis of that space, -1, 0 or 1 */
+    Byte ballInputX, ballInputZ;
+    bool jump;
+
+    /* Makes the padding explicit, so frames are stored without any
+       uninitialized bytes. Always zero. */
+    UnsignedByte reserved;
+};
+
+}  // namespace GraphicsPlayground
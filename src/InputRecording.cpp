@@ -0,0 +1,153 @@
+#include "InputRecording.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Debug.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+constexpr const char Magic[4]{'P', 'G', 'I', 'R'};
+constexpr const UnsignedInt Version = 1;
+
+enum : UnsignedInt { HasChecksum = 1 << 0 };
+
+struct FileHeader {
+    char magic[4];
+    UnsignedInt version;
+    UnsignedInt boxCount;
+    UnsignedInt frameCount;
+    UnsignedInt flags;
+    UnsignedInt reserved;
+    UnsignedLong checksum;
+};
+
+static_assert(sizeof(FileHeader) == 32, "unexpected file header padding");
+static_assert(sizeof(Vector3) == 12, "unexpected box position size");
+static_assert(sizeof(InputFrame) == 36, "unexpected input frame padding");
+static_assert(offsetof(InputFrame, reserved) == 35,
+              "unexpected input frame layout");
+
+/* Whether the bytes are a frame addFrame() could have stored. Checked on
+   the bytes, as a bool that's neither 0 nor 1 can't be read. */
+bool isValidFrame(const char *data) {
+    Byte ballInput[2];
+    UnsignedByte jump, reserved;
+    std::memcpy(&ballInput[0], data + offsetof(InputFrame, ballInputX), 1);
+    std::memcpy(&ballInput[1], data + offsetof(InputFrame, ballInputZ), 1);
+    std::memcpy(&jump, data + offsetof(InputFrame, jump), 1);
+    std::memcpy(&reserved, data + offsetof(InputFrame, reserved), 1);
+    for (const Byte input : ballInput)
+        if (input < -1 || input > 1)
+            return false;
+    return jump <= 1 && reserved == 0;
+}
+
+}  // namespace
+
+Containers::ArrayView<const Vector3> InputRecording::boxes() const {
+    return _boxes;
+}
+
+void InputRecording::addBox(const Vector3 &position) {
+    arrayAppend(_boxes, position);
+}
+
+Containers::ArrayView<const InputFrame> InputRecording::frames() const {
+    return _frames;
+}
+
+void InputRecording::addFrame(const InputFrame &frame) {
+    /* Whatever the caller left in there, the stored frame has no bytes
+       that differ between identical sessions */
+    InputFrame stored = frame;
+    stored.reserved = 0;
+    arrayAppend(_frames, stored);
+}
+
+Containers::Optional<UnsignedLong> InputRecording::checksum() const {
+    return _checksum;
+}
+
+void InputRecording::setChecksum(UnsignedLong checksum) {
+    _checksum = checksum;
+}
+
+Containers::Optional<InputRecording> InputRecording::deserialize(
+    Containers::ArrayView<const char> data) {
+    FileHeader header;
+    if (data.size() < sizeof(FileHeader)) {
+        Error{} << "InputRecording::deserialize(): expected at least"
+                << sizeof(FileHeader) << "bytes but got" << data.size();
+        return {};
+    }
+
+    std::memcpy(&header, data.data(), sizeof(FileHeader));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.version != Version) {
+        Error{} << "InputRecording::deserialize(): invalid header";
+        return {};
+    }
+
+    /* In 64 bits, which the 32-bit counts can't overflow, unlike a 32-bit
+       std::size_t. Once the sizes match the data, the counts are bounded
+       by its size. */
+    const UnsignedLong boxDataSize =
+        UnsignedLong(header.boxCount) * sizeof(Vector3);
+    const UnsignedLong frameDataSize =
+        UnsignedLong(header.frameCount) * sizeof(InputFrame);
+    const UnsignedLong expectedSize =
+        sizeof(FileHeader) + boxDataSize + frameDataSize;
+    if (UnsignedLong(data.size()) != expectedSize) {
+        Error{} << "InputRecording::deserialize(): expected" << expectedSize
+                << "bytes for" << header.boxCount << "boxes and"
+                << header.frameCount << "frames but got" << data.size();
+        return {};
+    }
+
+    const char *const frameData =
+        data.data() + sizeof(FileHeader) + boxDataSize;
+    for (UnsignedInt i = 0; i != header.frameCount; ++i) {
+        if (!isValidFrame(frameData + i * sizeof(InputFrame))) {
+            Error{} << "InputRecording::deserialize(): invalid frame" << i;
+            return {};
+        }
+    }
+
+    Containers::Optional<InputRecording> out{InputRecording{}};
+    arrayResize(out->_boxes, NoInit, header.boxCount);
+    std::memcpy(out->_boxes.data(), data.data() + sizeof(FileHeader),
+                boxDataSize);
+    arrayResize(out->_frames, NoInit, header.frameCount);
+    std::memcpy(out->_frames.data(), frameData, frameDataSize);
+    if (header.flags & HasChecksum)
+        out->_checksum = header.checksum;
+    return out;
+}
+
+Containers::Array<char> InputRecording::serialize() const {
+    FileHeader header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.boxCount = UnsignedInt(_boxes.size());
+    header.frameCount = UnsignedInt(_frames.size());
+    if (_checksum) {
+        header.flags |= HasChecksum;
+        header.checksum = *_checksum;
+    }
+
+    const std::size_t boxDataSize = _boxes.size() * sizeof(Vector3);
+    const std::size_t frameDataSize = _frames.size() * sizeof(InputFrame);
+    Containers::Array<char> out{
+        NoInit, sizeof(FileHeader) + boxDataSize + frameDataSize};
+    std::memcpy(out.data(), &header, sizeof(FileHeader));
+    std::memcpy(out.data() + sizeof(FileHeader), _boxes.data(), boxDataSize);
+    std::memcpy(out.data() + sizeof(FileHeader) + boxDataSize,
+                _frames.data(), frameDataSize);
+    return out;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "InputFrame.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Input of every frame of a session together with the boxes it started
+   with, so it can be replayed in the application or headlessly with the
+   same result. Once finished, it gets a checksum of the body
+   transformations at the end, see Simulation::stateChecksum(), which a
+   replay is expected to arrive at as well. */
+class InputRecording {
+ public:
+    /* Positions of the boxes added to the simulation before the first
+       frame, in order */
+    Containers::ArrayView<const Vector3> boxes() const;
+    void addBox(const Vector3 &position);
+
+    Containers::ArrayView<const InputFrame> frames() const;
+    void addFrame(const InputFrame &frame);
+
+    /* Empty until set at the end of the recording */
+    Containers::Optional<UnsignedLong> checksum() const;
+    void setChecksum(UnsignedLong checksum);
+
+    /* Creates a recording from data produced by serialize(), prints a
+       message and returns an empty optional if the data are invalid */
+    static Containers::Optional<InputRecording> deserialize(
+        Containers::ArrayView<const char> data);
+
+    /* The frames are stored as they are in memory, 36 bytes each */
+    Containers::Array<char> serialize() const;
+
+ private:
+    Containers::Array<Vector3> _boxes;
+    Containers::Array<InputFrame> _frames;
+    Containers::Optional<UnsignedLong> _checksum;
+};
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,304 @@
+#include "InstanceStore.h"
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Packing.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+/* Marks handles of removed instances */
+constexpr UnsignedInt InvalidIndex = ~0u;
+
+/* Dirty static positions at most this far apart are merged into a single
+   range, uploading a few unchanged instances is cheaper than an extra
+   buffer update call */
+constexpr Int StaticUpdateGap = 8;
+
+}  // namespace
+
+InstanceStore::InstanceStore() = default;
+
+UnsignedInt InstanceStore::add(const Color3 &color, Float scale) {
+    UnsignedInt handle;
+    if (!_freeHandles.isEmpty()) {
+        handle = _freeHandles.back();
+        arrayRemoveSuffix(_freeHandles);
+    } else {
+        handle = UnsignedInt(_indices.size());
+        arrayAppend(_indices, 0u);
+    }
+
+    /* Appending keeps the instance in the dynamic partition */
+    _indices[handle] = UnsignedInt(_handles.size());
+    arrayAppend(_handles, handle);
+    arrayAppend(_translations, Vector3{});
+    arrayAppend(_rotations, Quaternion{});
+    arrayAppend(_scales, scale);
+    arrayAppend(_colors, color);
+    arrayAppend(_lastChanges, _updateCount);
+    return handle;
+}
+
+void InstanceStore::remove(UnsignedInt handle) {
+    CORRADE_ASSERT(handle < _indices.size() &&
+                       _indices[handle] != InvalidIndex,
+                   "InstanceStore::remove(): invalid handle" << handle, );
+
+    /* A static instance first moves to the end of the static partition, the
+       instance it swapped places with has to be uploaded again */
+    UnsignedInt index = _indices[handle];
+    if (index < _staticCount) {
+        const UnsignedInt lastStatic = UnsignedInt(_staticCount - 1);
+        swapInstances(index, lastStatic);
+        arrayAppend(_dirtyStatic, index);
+        --_staticCount;
+        index = lastStatic;
+    }
+
+    /* Then the last instance moves into the freed slot */
+    swapInstances(index, UnsignedInt(_handles.size() - 1));
+    arrayRemoveSuffix(_translations);
+    arrayRemoveSuffix(_rotations);
+    arrayRemoveSuffix(_scales);
+    arrayRemoveSuffix(_colors);
+    arrayRemoveSuffix(_lastChanges);
+    arrayRemoveSuffix(_handles);
+    _indices[handle] = InvalidIndex;
+    arrayAppend(_freeHandles, handle);
+}
+
+void InstanceStore::setTransformation(UnsignedInt handle,
+                                      const Vector3 &translation,
+                                      const Quaternion &rotation) {
+    const UnsignedInt index = _indices[handle];
+    if (_translations[index] == translation && _rotations[index] == rotation)
+        return;
+
+    _translations[index] = translation;
+    _rotations[index] = rotation;
+    markChanged(handle, index);
+}
+
+void InstanceStore::setColor(UnsignedInt handle, const Color3 &color) {
+    const UnsignedInt index = _indices[handle];
+    if (_colors[index] == color)
+        return;
+
+    _colors[index] = color;
+    markChanged(handle, index);
+}
+
+void InstanceStore::markChanged(UnsignedInt handle, UnsignedInt index) {
+    /* Only static instances need to be moved in update(), and each just
+       once */
+    if (index < _staticCount && _lastChanges[index] != _updateCount)
+        arrayAppend(_changedHandles, handle);
+    _lastChanges[index] = _updateCount;
+}
+
+void InstanceStore::swapInstances(UnsignedInt a, UnsignedInt b) {
+    if (a == b)
+        return;
+
+    std::swap(_translations[a], _translations[b]);
+    std::swap(_rotations[a], _rotations[b]);
+    std::swap(_scales[a], _scales[b]);
+    std::swap(_colors[a], _colors[b]);
+    std::swap(_lastChanges[a], _lastChanges[b]);
+    std::swap(_handles[a], _handles[b]);
+    _indices[_handles[a]] = a;
+    _indices[_handles[b]] = b;
+}
+
+UnsignedInt InstanceStore::staticFrameCount() const {
+    return _staticFrameCount;
+}
+
+InstanceStore &InstanceStore::setStaticFrameCount(UnsignedInt count) {
+    /* With zero, instances changed in this frame would become static right
+       away and markChanged() would no longer tell them apart */
+    _staticFrameCount = Math::max(count, 1u);
+    return *this;
+}
+
+void InstanceStore::update() {
+    /* Changed static instances move to the front of the dynamic partition.
+       Handles of instances removed in the meantime are invalid or point to
+       a new dynamic instance, both fail the check. */
+    for (const UnsignedInt handle : _changedHandles) {
+        const UnsignedInt index = _indices[handle];
+        if (index >= _staticCount)
+            continue;
+
+        swapInstances(index, UnsignedInt(_staticCount - 1));
+        arrayAppend(_dirtyStatic, index);
+        --_staticCount;
+    }
+    arrayResize(_changedHandles, 0);
+
+    /* Dynamic instances that settled move to the end of the static
+       partition. The instance swapped into place of a promoted one was
+       already looked at, so the loop can always advance. */
+    for (std::size_t i = _staticCount; i != _handles.size(); ++i) {
+        if (_updateCount - _lastChanges[i] < _staticFrameCount)
+            continue;
+
+        swapInstances(UnsignedInt(i), UnsignedInt(_staticCount));
+        arrayAppend(_dirtyStatic, UnsignedInt(_staticCount));
+        ++_staticCount;
+    }
+
+    /* Positions that ended up in the dynamic partition don't need to be
+       uploaded, merge the rest into ranges */
+    arrayResize(_staticUpdates, 0);
+    std::sort(_dirtyStatic.begin(), _dirtyStatic.end());
+    for (const UnsignedInt index : _dirtyStatic) {
+        if (index >= _staticCount)
+            break;
+        if (!_staticUpdates.isEmpty() &&
+            Int(index) <= _staticUpdates.back().max() + StaticUpdateGap)
+            _staticUpdates.back().max() =
+                Math::max(_staticUpdates.back().max(), Int(index) + 1);
+        else
+            arrayAppend(_staticUpdates, Range1Di{Int(index), Int(index) + 1});
+    }
+    arrayResize(_dirtyStatic, 0);
+
+    ++_updateCount;
+}
+
+UnsignedInt InstanceStore::updateCount() const {
+    return _updateCount;
+}
+
+ThreadPool *InstanceStore::threadPool() const {
+    return _threadPool;
+}
+
+InstanceStore &InstanceStore::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+    return *this;
+}
+
+std::size_t InstanceStore::size() const {
+    return _handles.size();
+}
+
+std::size_t InstanceStore::staticCount() const {
+    return _staticCount;
+}
+
+Containers::ArrayView<const Range1Di> InstanceStore::staticUpdates() const {
+    return _staticUpdates;
+}
+
+Containers::ArrayView<const Vector3> InstanceStore::translations() const {
+    return _translations;
+}
+
+Containers::ArrayView<const Quaternion> InstanceStore::rotations() const {
+    return _rotations;
+}
+
+Containers::ArrayView<const Float> InstanceStore::scales() const {
+    return _scales;
+}
+
+Containers::ArrayView<const Color3> InstanceStore::colors() const {
+    return _colors;
+}
+
+void InstanceStore::fillInstance(InstanceData &out, std::size_t index) const {
+    /* With a uniform scale, the normal matrix is just the rotation divided
+       by the scale, no need for a full inverse */
+    const Matrix3x3 rotation = _rotations[index].toMatrix();
+    const Float scale = _scales[index];
+    out.transformationMatrix =
+        Matrix4::from(rotation * scale, _translations[index]);
+    out.normalMatrix = rotation * (1.0f / scale);
+    out.color = _colors[index];
+}
+
+void InstanceStore::fillInstance(CompactInstanceData &out,
+                                 std::size_t index) const {
+    const Quaternion &rotation = _rotations[index];
+    out.translation = _translations[index];
+    out.scale = _scales[index];
+    out.rotation =
+        Math::pack<Vector4s>(Vector4{rotation.vector(), rotation.scalar()});
+    out.color = Math::pack<Color4ub>(Color4{_colors[index]});
+    out.padding = 0;
+}
+
+template <class F>
+void InstanceStore::fill(std::size_t count, F &&f) const {
+    PLAYGROUND_PROFILE(Instances);
+    if (_threadPool)
+        _threadPool->run(count, FillChunkSize, f);
+    else
+        f(0, count);
+}
+
+void InstanceStore::fillInstanceData(Containers::ArrayView<InstanceData> out,
+                                     std::size_t offset) const {
+    CORRADE_ASSERT(offset + out.size() <= size(),
+                   "InstanceStore::fillInstanceData(): range"
+                       << offset << out.size() << "out of bounds for"
+                       << size() << "items", );
+
+    fill(out.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            fillInstance(out[i], offset + i);
+    });
+}
+
+void InstanceStore::fillInstanceData(
+    Containers::ArrayView<CompactInstanceData> out,
+    std::size_t offset) const {
+    CORRADE_ASSERT(offset + out.size() <= size(),
+                   "InstanceStore::fillInstanceData(): range"
+                       << offset << out.size() << "out of bounds for"
+                       << size() << "items", );
+
+    fill(out.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            fillInstance(out[i], offset + i);
+    });
+}
+
+void InstanceStore::fillInstanceData(
+    Containers::ArrayView<InstanceData> out,
+    Containers::ArrayView<const UnsignedInt> indices) const {
+    CORRADE_ASSERT(out.size() == indices.size(),
+                   "InstanceStore::fillInstanceData(): expected"
+                       << indices.size() << "items but got" << out.size(), );
+
+    fill(out.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            fillInstance(out[i], indices[i]);
+    });
+}
+
+void InstanceStore::fillInstanceData(
+    Containers::ArrayView<CompactInstanceData> out,
+    Containers::ArrayView<const UnsignedInt> indices) const {
+    CORRADE_ASSERT(out.size() == indices.size(),
+                   "InstanceStore::fillInstanceData(): expected"
+                       << indices.size() << "items but got" << out.size(), );
+
+    fill(out.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i)
+            fillInstance(out[i], indices[i]);
+    });
+}
+
+}  // namespace GraphicsPlayground
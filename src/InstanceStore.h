@@ -0,0 +1,136 @@
+#pragma once
+
+#include "CompactInstanceData.h"
+#include "InstanceData.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Quaternion.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class ThreadPool;
+
+/* World transformations and colors of all instances of one mesh, kept in
+   contiguous arrays so the per-frame instance data can be built in a single
+   linear pass. Instances are referenced by handles that stay valid until
+   the instance is removed.
+
+   The arrays are partitioned into static instances, which didn't change for
+   a while, followed by dynamic ones. Static instances are meant to stay
+   resident on the GPU, with only the ranges listed by staticUpdates()
+   uploaded again, so the per-frame cost scales with the number of moving
+   instances rather than the total. */
+class InstanceStore {
+ public:
+    InstanceStore();
+
+    /* Returns a handle to the new instance, with an identity
+       transformation. New instances are dynamic. */
+    UnsignedInt add(const Color3 &color, Float scale);
+    void remove(UnsignedInt handle);
+
+    /* Setting the same value as before doesn't count as a change */
+    void setTransformation(UnsignedInt handle, const Vector3 &translation,
+                           const Quaternion &rotation);
+    void setColor(UnsignedInt handle, const Color3 &color);
+
+    /* Number of update() calls an instance has to stay unchanged for to
+       become static. Defaults to 30. */
+    UnsignedInt staticFrameCount() const;
+    InstanceStore &setStaticFrameCount(UnsignedInt count);
+
+    /* Moves changed static instances to the dynamic partition and
+       instances that didn't change for long enough to the static one, and
+       collects the static ranges that need to be uploaded again. Meant to
+       be called once per frame. */
+    void update();
+
+    /* Number of update() calls so far, lets users detect whether they
+       missed the static updates of some frame */
+    UnsignedInt updateCount() const;
+
+    std::size_t size() const;
+
+    /* Static instances are [0, staticCount()), dynamic ones
+       [staticCount(), size()) */
+    std::size_t staticCount() const;
+
+    /* Sorted non-overlapping ranges of the static partition whose contents
+       changed in the last update() */
+    Containers::ArrayView<const Range1Di> staticUpdates() const;
+
+    /* Dense per-instance data, in the order described above */
+    Containers::ArrayView<const Vector3> translations() const;
+    Containers::ArrayView<const Quaternion> rotations() const;
+    Containers::ArrayView<const Float> scales() const;
+    Containers::ArrayView<const Color3> colors() const;
+
+    /* Pool the fillInstanceData() functions split their work across, in
+       chunks of FillChunkSize instances each writing its own slice of the
+       output. Null, the default, fills on the calling thread. */
+    ThreadPool *threadPool() const;
+    InstanceStore &setThreadPool(ThreadPool *pool);
+
+    enum : std::size_t { FillChunkSize = 4096 };
+
+    /* Writes transformation and normal matrices in world space of instances
+       starting at given offset, as many as the view has items */
+    void fillInstanceData(Containers::ArrayView<InstanceData> out,
+                          std::size_t offset = 0) const;
+
+    /* Same as above, but writes the packed format */
+    void fillInstanceData(Containers::ArrayView<CompactInstanceData> out,
+                          std::size_t offset = 0) const;
+
+    /* Writes data of instances at given dense indices, for example those
+       that passed culling */
+    void fillInstanceData(Containers::ArrayView<InstanceData> out,
+                          Containers::ArrayView<const UnsignedInt> indices)
+        const;
+    void fillInstanceData(Containers::ArrayView<CompactInstanceData> out,
+                          Containers::ArrayView<const UnsignedInt> indices)
+        const;
+
+ private:
+    void fillInstance(InstanceData &out, std::size_t index) const;
+    void fillInstance(CompactInstanceData &out, std::size_t index) const;
+    /* Calls f(begin, end) over [0, count), on the pool if there's one */
+    template <class F> void fill(std::size_t count, F &&f) const;
+    void markChanged(UnsignedInt handle, UnsignedInt index);
+    void swapInstances(UnsignedInt a, UnsignedInt b);
+
+    Containers::Array<Vector3> _translations;
+    Containers::Array<Quaternion> _rotations;
+    Containers::Array<Float> _scales;
+    Containers::Array<Color3> _colors;
+    /* Value of _updateCount when the instance last changed */
+    Containers::Array<UnsignedInt> _lastChanges;
+
+    /* Dense index of each handle and the other way around, removed handles
+       are reused */
+    Containers::Array<UnsignedInt> _indices;
+    Containers::Array<UnsignedInt> _handles;
+    Containers::Array<UnsignedInt> _freeHandles;
+
+    std::size_t _staticCount{};
+    UnsignedInt _staticFrameCount{30};
+    UnsignedInt _updateCount{};
+
+    /* Handles changed since the last update(), positions of the static
+       partition overwritten since the last update() and the resulting
+       ranges */
+    Containers::Array<UnsignedInt> _changedHandles;
+    Containers::Array<UnsignedInt> _dirtyStatic;
+    Containers::Array<Range1Di> _staticUpdates;
+
+    ThreadPool *_threadPool{};
+};
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,67 @@
+#include "InstanceStream.h"
+
+#include "Profiler.h"
+
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+InstanceStream::InstanceStream(NoCreateT) noexcept {}
+
+InstanceStream::InstanceStream(std::size_t initialCapacity) {
+    for (std::size_t i = 0; i != SlotCount; ++i) {
+        _buffers[i] = GL::Buffer{};
+        _buffers[i].setData({nullptr, initialCapacity},
+                            GL::BufferUsage::DynamicDraw);
+        _capacities[i] = initialCapacity;
+    }
+}
+
+GL::Buffer &InstanceStream::buffer(std::size_t slot) {
+    return _buffers[slot];
+}
+
+std::size_t InstanceStream::capacity(std::size_t slot) const {
+    return _capacities[slot];
+}
+
+std::size_t InstanceStream::slot() const {
+    return _slot;
+}
+
+std::size_t InstanceStream::upload(Containers::ArrayView<const void> data) {
+    _slot = (_slot + 1) % SlotCount;
+    if (data.isEmpty())
+        return _slot;
+
+    PLAYGROUND_PROFILE(Upload);
+
+    /* The buffer keeps its ID on reallocation, so meshes referencing it
+       don't need to be updated */
+    GL::Buffer &buffer = _buffers[_slot];
+    if (data.size() > _capacities[_slot]) {
+        _capacities[_slot] = Math::max(data.size(), 2 * _capacities[_slot]);
+        buffer.setData({nullptr, _capacities[_slot]},
+                       GL::BufferUsage::DynamicDraw);
+        ++_reallocations;
+    }
+
+    buffer.setSubData(0, data);
+    _uploadedBytes += data.size();
+    return _slot;
+}
+
+std::size_t InstanceStream::uploadedBytes() const {
+    return _uploadedBytes;
+}
+
+std::size_t InstanceStream::reallocations() const {
+    return _reallocations;
+}
+
+void InstanceStream::resetStatistics() {
+    _uploadedBytes = 0;
+    _reallocations = 0;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Ring of instance buffers, each frame writes into the buffer following the
+   one used in the previous frame. Buffers are updated in place with
+   setSubData() and reallocated only when the data don't fit, growing
+   geometrically, so fluctuating instance counts don't cause a new driver
+   allocation every frame. Three buffers let the CPU write one while the GPU
+   may still read the two previous. */
+class InstanceStream {
+ public:
+    enum : std::size_t { SlotCount = 3 };
+
+    explicit InstanceStream(NoCreateT) noexcept;
+    explicit InstanceStream(std::size_t initialCapacity = 4096);
+
+    GL::Buffer &buffer(std::size_t slot);
+    std::size_t capacity(std::size_t slot) const;
+
+    /* Slot written by the last upload() */
+    std::size_t slot() const;
+
+    /* Moves to the next slot and copies given data to the beginning of its
+       buffer, returns the slot */
+    std::size_t upload(Containers::ArrayView<const void> data);
+
+    /* Counters since the last resetStatistics() */
+    std::size_t uploadedBytes() const;
+    std::size_t reallocations() const;
+    void resetStatistics();
+
+ private:
+    GL::Buffer _buffers[SlotCount]{GL::Buffer{NoCreate}, GL::Buffer{NoCreate},
+                                   GL::Buffer{NoCreate}};
+    std::size_t _capacities[SlotCount]{};
+    std::size_t _slot{};
+
+    std::size_t _uploadedBytes{}, _reallocations{};
+};
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,429 @@
+#include "InstancedMesh.h"
+
+#include "CompactPhongGL.h"
+#include "FrustumCuller.h"
+#include "InstanceStore.h"
+#include "MeshBatch.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/MeshTools/Tipsify.h>
+#include <Magnum/Shaders/PhongGL.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include <chrono>
+#include <utility>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+constexpr std::size_t InitialStaticCapacity = 4096;
+
+/* Post-transform vertex cache size the index buffers are optimized for, a
+   conservative value that suits most GPUs */
+constexpr std::size_t VertexCacheSize = 24;
+
+void addPhongInstanceBuffer(GL::Mesh &mesh, GL::Buffer &buffer) {
+    mesh.addVertexBufferInstanced(buffer, 1, 0,
+                                  Shaders::PhongGL::TransformationMatrix{},
+                                  Shaders::PhongGL::NormalMatrix{},
+                                  Shaders::PhongGL::Color3{});
+}
+
+}  // namespace
+
+InstancedMesh::InstancedMesh(NoCreateT) noexcept {}
+
+InstancedMesh::InstancedMesh(const Trade::MeshData &meshData,
+                             MeshBatch *batch)
+    : _batch{batch} {
+    /* Has to exist before the levels, their meshes reference it */
+    _static = GL::Buffer{};
+    _static.setData({nullptr, InitialStaticCapacity},
+                    GL::BufferUsage::DynamicDraw);
+    _staticCapacity = InitialStaticCapacity;
+    if (_batch)
+        _batchStaticRegion = _batch->addStaticRegion();
+
+    addLevelInternal(meshData, Constants::inf());
+}
+
+InstancedMesh &InstancedMesh::addLevel(const Trade::MeshData &meshData,
+                                       Float maxScreenRadius) {
+    CORRADE_ASSERT(maxScreenRadius < _levels.back().maxScreenRadius,
+                   "InstancedMesh::addLevel(): expected a radius smaller than"
+                       << _levels.back().maxScreenRadius << "but got"
+                       << maxScreenRadius,
+                   *this);
+    addLevelInternal(meshData, maxScreenRadius);
+    return *this;
+}
+
+void InstancedMesh::addLevelInternal(const Trade::MeshData &meshData,
+                                     Float maxScreenRadius) {
+    CORRADE_ASSERT(meshData.isIndexed(),
+                   "InstancedMesh: expected an indexed mesh", );
+
+    /* Reorder the triangles so vertices shared by neighbors are more
+       likely to still be in the post-transform cache. The vertices stay
+       the same, so the mesh is compiled from a view on the original vertex
+       data with the new indices. */
+    Containers::Array<UnsignedInt> indices = meshData.indicesAsArray();
+    MeshTools::tipsify(indices, meshData.vertexCount(), VertexCacheSize);
+    const Trade::MeshData optimized{
+        meshData.primitive(),
+        {},
+        indices,
+        Trade::MeshIndexData{indices},
+        {},
+        meshData.vertexData(),
+        Trade::meshAttributeDataNonOwningArray(meshData.attributeData()),
+        meshData.vertexCount()};
+
+    Level level;
+    level.indices = GL::Buffer{GL::Buffer::TargetHint::ElementArray};
+    level.indices.setData(indices);
+    level.vertices = GL::Buffer{};
+    level.vertices.setData(meshData.vertexData());
+    level.stream = InstanceStream{};
+    level.maxScreenRadius = maxScreenRadius;
+    level.triangleCount = indices.size() / 3;
+
+    for (std::size_t slot = 0; slot != InstanceStream::SlotCount; ++slot) {
+        level.meshes[slot] =
+            MeshTools::compile(optimized, level.indices, level.vertices);
+        addPhongInstanceBuffer(level.meshes[slot], level.stream.buffer(slot));
+
+        level.compactMeshes[slot] =
+            MeshTools::compile(optimized, level.indices, level.vertices);
+        CompactPhongGL::addInstanceBuffer(level.compactMeshes[slot],
+                                          level.stream.buffer(slot), 0);
+    }
+
+    level.staticMesh =
+        MeshTools::compile(optimized, level.indices, level.vertices);
+    addPhongInstanceBuffer(level.staticMesh, _static);
+    level.compactStaticMesh =
+        MeshTools::compile(optimized, level.indices, level.vertices);
+    CompactPhongGL::addInstanceBuffer(level.compactStaticMesh, _static, 0);
+
+    if (_batch)
+        level.batchMesh = _batch->addMesh(optimized);
+
+    for (const Vector3 &position : meshData.positions3DAsArray())
+        _boundingRadius = Math::max(_boundingRadius, position.length());
+
+    arrayAppend(_levels, std::move(level));
+}
+
+std::size_t InstancedMesh::levelCount() const {
+    return _levels.size();
+}
+
+void InstancedMesh::draw(Shaders::PhongGL &shader,
+                         const InstanceStore &store, const View &view) {
+    drawInstances(shader, store, view, Format::Full, _data);
+}
+
+void InstancedMesh::draw(CompactPhongGL &shader, const InstanceStore &store,
+                         const View &view) {
+    drawInstances(shader, store, view, Format::Compact, _compactData);
+}
+
+std::size_t InstancedMesh::cullInstances(const InstanceStore &store,
+                                         std::size_t begin, std::size_t end,
+                                         const View &view) {
+    const Containers::ArrayView<const Vector3> translations =
+        store.translations();
+    const Containers::ArrayView<const Float> scales = store.scales();
+    const std::size_t first = _visible.size();
+    if (view.culler) {
+        view.culler->cull(translations.slice(begin, end),
+                          scales.slice(begin, end), _boundingRadius,
+                          UnsignedInt(begin), _visible);
+    } else {
+        for (std::size_t i = begin; i != end; ++i)
+            arrayAppend(_visible, UnsignedInt(i));
+    }
+
+    /* Occlusion is more expensive, so it's only tested for instances that
+       are in the frustum */
+    if (view.occlusionCuller) {
+        const std::size_t inFrustum = _visible.size() - first;
+        const std::size_t visible = view.occlusionCuller->cull(
+            translations, scales, _boundingRadius,
+            _visible.exceptPrefix(first));
+        _occludedCount += inFrustum - visible;
+        arrayResize(_visible, first + visible);
+    }
+
+    return _visible.size() - first;
+}
+
+UnsignedInt InstancedMesh::selectLevel(const InstanceStore &store,
+                                       UnsignedInt index,
+                                       const View &view) const {
+    if (_levels.size() == 1 || view.pixelsPerUnit <= 0.0f)
+        return 0;
+
+    /* Projected radius of the bounding sphere, the finest level if the
+       camera is inside */
+    const Float radius = store.scales()[index] * _boundingRadius;
+    const Float distance =
+        (store.translations()[index] - view.cameraPosition).length();
+    if (distance <= radius)
+        return 0;
+    const Float screenRadius = radius * view.pixelsPerUnit / distance;
+
+    UnsignedInt level = 0;
+    while (level + 1 != _levels.size() &&
+           screenRadius < _levels[level + 1].maxScreenRadius)
+        ++level;
+    return level;
+}
+
+InstancedMesh::Level *InstancedMesh::selectInstances(
+    const InstanceStore &store, const View &view, const bool useIndices,
+    const bool residentStatic) {
+    const std::size_t staticCount = store.staticCount();
+    for (Level &level : _levels) {
+        arrayResize(level.instances, 0);
+        level.drawnCount = 0;
+    }
+    _occludedCount = 0;
+    _sortTime = 0.0;
+    _incrementalSortCount = 0;
+
+    /* Visible instances are bucketed by level. The resident static ones
+       are drawn whole if most of them are visible and all use the same
+       level. */
+    Level *staticLevel =
+        residentStatic && staticCount ? &_levels[0] : nullptr;
+    if (!useIndices) {
+        _visibleCount = store.size();
+        return staticLevel;
+    }
+
+    arrayResize(_visible, 0);
+    const std::size_t visibleStatic =
+        cullInstances(store, 0, staticCount, view);
+    if (staticLevel && 2 * visibleStatic >= staticCount) {
+        const UnsignedInt level = selectLevel(store, _visible[0], view);
+        for (std::size_t i = 1; staticLevel && i != visibleStatic; ++i)
+            if (selectLevel(store, _visible[i], view) != level)
+                staticLevel = nullptr;
+        if (staticLevel) {
+            staticLevel = &_levels[level];
+            arrayResize(_visible, 0);
+        }
+    } else
+        staticLevel = nullptr;
+    const std::size_t visibleDynamic =
+        cullInstances(store, staticCount, store.size(), view);
+    _visibleCount = visibleStatic + visibleDynamic;
+
+    for (const UnsignedInt index : _visible)
+        arrayAppend(_levels[selectLevel(store, index, view)].instances,
+                    index);
+
+    /* Nearest first in each level, so the depth test can reject more of
+       what's behind */
+    if (view.sortFrontToBack) {
+        const auto start = std::chrono::steady_clock::now();
+        for (Level &level : _levels) {
+            if (level.instances.isEmpty())
+                continue;
+            level.sorter.sort(store.translations(), view.cameraPosition,
+                              view.viewDirection, level.instances);
+            if (level.sorter.lastSortIncremental())
+                ++_incrementalSortCount;
+        }
+        _sortTime = std::chrono::duration<Double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    }
+
+    return staticLevel;
+}
+
+void InstancedMesh::addDraws(const InstanceStore &store, const View &view) {
+    CORRADE_ASSERT(_batch,
+                   "InstancedMesh::addDraws(): the mesh was not created with "
+                   "a batch", );
+
+    /* The static region is kept current even if it isn't drawn in this
+       frame, the same as the static buffer in draw() */
+    _batch->updateStaticRegion(_batchStaticRegion, store);
+    Level *const staticLevel = selectInstances(store, view, true, true);
+
+    _drawnCount = 0;
+    if (staticLevel) {
+        _batch->addStaticDraw(staticLevel->batchMesh, _batchStaticRegion);
+        staticLevel->drawnCount += store.staticCount();
+        _drawnCount += store.staticCount();
+    }
+
+    for (Level &level : _levels) {
+        arrayResize(_compactData, NoInit, level.instances.size());
+        store.fillInstanceData(_compactData, level.instances);
+        _batch->addDraw(level.batchMesh, _compactData);
+        level.drawnCount += level.instances.size();
+        _drawnCount += level.instances.size();
+    }
+}
+
+template <class T, class Shader>
+void InstancedMesh::drawInstances(Shader &shader, const InstanceStore &store,
+                                  const View &view, Format format,
+                                  Containers::Array<T> &data) {
+    const std::size_t staticCount = store.staticCount();
+    const std::size_t dynamicCount = store.size() - staticCount;
+
+    /* The dirty ranges are relative to the previous update, if the store
+       was updated more than once since the last upload or the contents are
+       in a different format, everything has to be uploaded again. If it
+       wasn't updated at all, the buffer is already current. */
+    bool uploadAll = format != _staticFormat ||
+                     store.updateCount() - _staticUpdateCount > 1;
+    const bool uploadRanges = store.updateCount() != _staticUpdateCount;
+
+    /* The buffer keeps its ID on reallocation like the ones in the stream,
+       but loses its contents */
+    if (staticCount * sizeof(T) > _staticCapacity) {
+        _staticCapacity =
+            Math::max(staticCount * sizeof(T), 2 * _staticCapacity);
+        _static.setData({nullptr, _staticCapacity},
+                        GL::BufferUsage::DynamicDraw);
+        ++_reallocations;
+        uploadAll = true;
+    }
+
+    if (uploadAll) {
+        arrayResize(data, NoInit, staticCount);
+        store.fillInstanceData(data);
+        PLAYGROUND_PROFILE(Upload);
+        _static.setSubData(0, data);
+        _uploadedBytes += staticCount * sizeof(T);
+    } else if (uploadRanges) {
+        for (const Range1Di &range : store.staticUpdates()) {
+            arrayResize(data, NoInit, std::size_t(range.size()));
+            store.fillInstanceData(data, range.min());
+            PLAYGROUND_PROFILE(Upload);
+            _static.setSubData(range.min() * sizeof(T), data);
+            _uploadedBytes += data.size() * sizeof(T);
+        }
+    }
+    _staticFormat = format;
+    _staticUpdateCount = store.updateCount();
+
+    /* Without culling, level selection and sorting everything is visible
+       in the finest level, and the dynamic partition can be filled
+       directly. The static buffer is kept current above even if it isn't
+       drawn in this frame, so it doesn't need a full upload once it's drawn
+       again. */
+    const bool useIndices = view.culler || view.occlusionCuller ||
+                            view.sortFrontToBack ||
+                            (_levels.size() > 1 && view.pixelsPerUnit > 0.0f);
+    Level *const staticLevel = selectInstances(store, view, useIndices, true);
+
+    _drawnCount = 0;
+    if (staticLevel) {
+        GL::Mesh &mesh = format == Format::Full
+                             ? staticLevel->staticMesh
+                             : staticLevel->compactStaticMesh;
+        mesh.setInstanceCount(staticCount);
+        shader.draw(mesh);
+        staticLevel->drawnCount += staticCount;
+        _drawnCount += staticCount;
+    }
+
+    for (std::size_t i = 0; i != _levels.size(); ++i) {
+        Level &level = _levels[i];
+        if (useIndices) {
+            arrayResize(data, NoInit, level.instances.size());
+            store.fillInstanceData(data, level.instances);
+        } else {
+            arrayResize(data, NoInit, i ? 0 : dynamicCount);
+            store.fillInstanceData(data, staticCount);
+        }
+
+        const std::size_t slot = level.stream.upload(data);
+        if (data.isEmpty())
+            continue;
+
+        GL::Mesh &mesh = format == Format::Full ? level.meshes[slot]
+                                                : level.compactMeshes[slot];
+        mesh.setInstanceCount(data.size());
+        shader.draw(mesh);
+        level.drawnCount += data.size();
+        _drawnCount += data.size();
+    }
+}
+
+InstanceStream &InstancedMesh::stream(std::size_t level) {
+    return _levels[level].stream;
+}
+
+Float InstancedMesh::boundingRadius() const {
+    return _boundingRadius;
+}
+
+std::size_t InstancedMesh::visibleCount() const {
+    return _visibleCount;
+}
+
+std::size_t InstancedMesh::occludedCount() const {
+    return _occludedCount;
+}
+
+std::size_t InstancedMesh::drawnCount() const {
+    return _drawnCount;
+}
+
+std::size_t InstancedMesh::drawnCount(std::size_t level) const {
+    return _levels[level].drawnCount;
+}
+
+std::size_t InstancedMesh::drawnTriangleCount() const {
+    std::size_t count = 0;
+    for (const Level &level : _levels)
+        count += level.drawnCount * level.triangleCount;
+    return count;
+}
+
+Double InstancedMesh::sortTime() const {
+    return _sortTime;
+}
+
+std::size_t InstancedMesh::incrementalSortCount() const {
+    return _incrementalSortCount;
+}
+
+std::size_t InstancedMesh::uploadedBytes() const {
+    std::size_t bytes = _uploadedBytes;
+    for (const Level &level : _levels)
+        bytes += level.stream.uploadedBytes();
+    return bytes;
+}
+
+std::size_t InstancedMesh::reallocations() const {
+    std::size_t count = _reallocations;
+    for (const Level &level : _levels)
+        count += level.stream.reallocations();
+    return count;
+}
+
+void InstancedMesh::resetStatistics() {
+    _uploadedBytes = 0;
+    _reallocations = 0;
+    for (Level &level : _levels)
+        level.stream.resetStatistics();
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "CompactInstanceData.h"
+#include "DepthSorter.h"
+#include "InstanceData.h"
+#include "InstanceStream.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Shaders/Shaders.h>
+#include <Magnum/Trade/Trade.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class CompactPhongGL;
+class FrustumCuller;
+class InstanceStore;
+class MeshBatch;
+class OcclusionCuller;
+
+/* Mesh drawn with per-instance data of an InstanceStore, in one or more
+   levels of detail. Static instances stay resident in a buffer of their
+   own, which only gets the ranges that changed since the previous frame.
+   Other instances are bucketed by level and streamed through an
+   InstanceStream of each level, with one GL mesh for each slot of the
+   stream and each instance format. */
+class InstancedMesh {
+ public:
+    /* How instances get culled and their level of detail selected */
+    struct View {
+        /* Either can be null */
+        const FrustumCuller *culler{};
+        const OcclusionCuller *occlusionCuller{};
+
+        /* Camera position and normalized view direction in world space
+           and the size of a unit at unit distance in pixels. With zero size
+           the finest level is always used. */
+        Vector3 cameraPosition, viewDirection{0.0f, 0.0f, -1.0f};
+        Float pixelsPerUnit{};
+
+        /* Draw the streamed instances of each level front to back */
+        bool sortFrontToBack{};
+    };
+
+    explicit InstancedMesh(NoCreateT) noexcept;
+
+    /* The mesh is the finest level of detail. If a batch is passed, all
+       levels are added to it as well and the instances can be drawn
+       through it with addDraws(). The batch has to outlive the mesh. */
+    explicit InstancedMesh(const Trade::MeshData &meshData,
+                           MeshBatch *batch = nullptr);
+
+    /* Adds a coarser level, used for instances with projected radius below
+       given number of pixels. Has to be added in order of decreasing
+       radius. */
+    InstancedMesh &addLevel(const Trade::MeshData &meshData,
+                            Float maxScreenRadius);
+
+    std::size_t levelCount() const;
+
+    /* Uploads what changed in given store and draws all its instances with
+       one draw call for the static partition and one for each level of
+       the rest. Switching between the shaders uploads all static instances
+       again, as does skipping an InstanceStore::update().
+
+       With culling, only visible instances are uploaded. The resident
+       static instances are drawn whole if at least half of them is visible
+       and all visible ones use the same level, otherwise the visible ones
+       are streamed together with the rest. Sorting only reorders the
+       streamed instances, the resident ones stay in store order. */
+    void draw(Shaders::PhongGL &shader, const InstanceStore &store,
+              const View &view = View{});
+    void draw(CompactPhongGL &shader, const InstanceStore &store,
+              const View &view = View{});
+
+    /* Culls and selects the levels like draw(), but adds a draw for each
+       level to the batch passed in the constructor instead of drawing. The
+       static instances are kept in a static region of the batch, drawn
+       whole under the same conditions as the resident ones in draw(). */
+    void addDraws(const InstanceStore &store, const View &view = View{});
+
+    InstanceStream &stream(std::size_t level = 0);
+
+    /* Radius of a sphere around the origin enclosing the mesh vertices,
+       multiplied by the instance scale for culling */
+    Float boundingRadius() const;
+
+    /* Instances that passed culling, instances in the frustum that were
+       occluded and instances actually drawn, including invisible static
+       ones, in the last draw() */
+    std::size_t visibleCount() const;
+    std::size_t occludedCount() const;
+    std::size_t drawnCount() const;
+
+    /* Instances drawn with given level and triangles drawn in total in the
+       last draw() */
+    std::size_t drawnCount(std::size_t level) const;
+    std::size_t drawnTriangleCount() const;
+
+    /* Time spent sorting the instances in the last draw() in milliseconds
+       and how many levels were sorted incrementally from the previous
+       order */
+    Double sortTime() const;
+    std::size_t incrementalSortCount() const;
+
+    /* Counters since the last resetStatistics(), including the streams */
+    std::size_t uploadedBytes() const;
+    std::size_t reallocations() const;
+    void resetStatistics();
+
+ private:
+    enum class Format : UnsignedByte { None, Full, Compact };
+
+    struct Level {
+        GL::Buffer indices{NoCreate}, vertices{NoCreate};
+        InstanceStream stream{NoCreate};
+        GL::Mesh meshes[InstanceStream::SlotCount]{
+            GL::Mesh{NoCreate}, GL::Mesh{NoCreate}, GL::Mesh{NoCreate}};
+        GL::Mesh compactMeshes[InstanceStream::SlotCount]{
+            GL::Mesh{NoCreate}, GL::Mesh{NoCreate}, GL::Mesh{NoCreate}};
+        /* Drawing the resident static instances */
+        GL::Mesh staticMesh{NoCreate}, compactStaticMesh{NoCreate};
+        Float maxScreenRadius{};
+        std::size_t triangleCount{};
+
+        /* Instances selected for this level in the current frame and
+           instances drawn with it, including static ones */
+        Containers::Array<UnsignedInt> instances;
+        std::size_t drawnCount{};
+        DepthSorter sorter;
+        /* Mesh ID in the batch, if any */
+        UnsignedInt batchMesh{};
+    };
+
+    void addLevelInternal(const Trade::MeshData &meshData,
+                          Float maxScreenRadius);
+
+    /* Appends indices of visible instances in given range to _visible,
+       returns their count */
+    std::size_t cullInstances(const InstanceStore &store, std::size_t begin,
+                              std::size_t end, const View &view);
+
+    /* Buckets visible instances to the levels and sorts them. Returns the
+       level to draw the whole static partition with, if any. */
+    Level *selectInstances(const InstanceStore &store, const View &view,
+                           bool useIndices, bool residentStatic);
+
+    UnsignedInt selectLevel(const InstanceStore &store, UnsignedInt index,
+                            const View &view) const;
+
+    template <class T, class Shader>
+    void drawInstances(Shader &shader, const InstanceStore &store,
+                       const View &view, Format format,
+                       Containers::Array<T> &data);
+
+    Containers::Array<Level> _levels;
+    Float _boundingRadius{};
+    MeshBatch *_batch{};
+    UnsignedInt _batchStaticRegion{};
+
+    /* Resident static instances, in the format and as of the store update
+       they were last uploaded for */
+    GL::Buffer _static{NoCreate};
+    std::size_t _staticCapacity{};
+    Format _staticFormat{Format::None};
+    UnsignedInt _staticUpdateCount{};
+
+    /* Scratch space for culling and building the instance data */
+    Containers::Array<UnsignedInt> _visible;
+    Containers::Array<InstanceData> _data;
+    Containers::Array<CompactInstanceData> _compactData;
+
+    std::size_t _uploadedBytes{}, _reallocations{};
+    std::size_t _visibleCount{}, _occludedCount{}, _drawnCount{};
+    Double _sortTime{};
+    std::size_t _incrementalSortCount{};
+};
+
+}  // namespace GraphicsPlayground
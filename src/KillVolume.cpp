@@ -0,0 +1,108 @@
+#include "KillVolume.h"
+
+#include "Rigidbody.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/BulletIntegration/Integration.h>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+/* How far the slabs extend beyond the bounds. Bodies are expected to be
+   removed long before getting through. */
+constexpr Float SlabThickness = 1.0e6f;
+
+}  // namespace
+
+KillVolume::KillVolume(btCollisionWorld &bWorld, const Range3D &bounds)
+    : _bWorld(bWorld) {
+    _bWorld.getPairCache()->setInternalGhostPairCallback(
+        &_bGhostPairCallback);
+
+    /* Only AABB overlaps are of interest, the slabs shouldn't push anything
+       away nor be visible in debug drawing */
+    for (btGhostObject &ghost : _bGhosts) {
+        ghost.setCollisionFlags(
+            btCollisionObject::CF_NO_CONTACT_RESPONSE |
+            btCollisionObject::CF_DISABLE_VISUALIZE_OBJECT);
+    }
+    setBounds(bounds);
+    for (btGhostObject &ghost : _bGhosts) {
+        _bWorld.addCollisionObject(
+            &ghost, btBroadphaseProxy::SensorTrigger,
+            btBroadphaseProxy::AllFilter & ~(btBroadphaseProxy::StaticFilter |
+                                             btBroadphaseProxy::SensorTrigger));
+    }
+}
+
+KillVolume::~KillVolume() {
+    for (btGhostObject &ghost : _bGhosts)
+        _bWorld.removeCollisionObject(&ghost);
+    _bWorld.getPairCache()->setInternalGhostPairCallback(nullptr);
+}
+
+const Range3D &KillVolume::bounds() const {
+    return _bounds;
+}
+
+void KillVolume::setBounds(const Range3D &bounds) {
+    _bounds = bounds;
+
+    /* Each slab covers the whole plane on the other two axes, so the
+       corners are covered twice or three times */
+    const Range3D outside = bounds.padded(Vector3{SlabThickness});
+    for (UnsignedInt i = 0; i != 6; ++i) {
+        const UnsignedInt axis = i / 2;
+        Range3D slab = outside;
+        if (i % 2)
+            slab.min()[axis] = bounds.max()[axis];
+        else
+            slab.max()[axis] = bounds.min()[axis];
+
+        _bShapes[i].emplace(btVector3{slab.size() * 0.5f});
+        _bGhosts[i].setCollisionShape(_bShapes[i].get());
+        _bGhosts[i].setWorldTransform(
+            btTransform{btMatrix3x3::getIdentity(), btVector3{slab.center()}});
+        if (_bGhosts[i].getBroadphaseHandle())
+            _bWorld.updateSingleAabb(&_bGhosts[i]);
+    }
+}
+
+void KillVolume::collect(Containers::Array<RigidBody *> &out) const {
+    for (UnsignedInt i = 0; i != 6; ++i) {
+        const btAlignedObjectArray<btCollisionObject *> &objects =
+            _bGhosts[i].getOverlappingPairs();
+        for (Int j = 0; j != objects.size(); ++j) {
+            /* A body in the corners is in more slabs, only the first takes
+               it. The pair may also still exist for a few steps after the
+               AABBs stopped overlapping. */
+            const btCollisionObject *object = objects[j];
+            if (!btRigidBody::upcast(object))
+                continue;
+            const Vector3 position{object->getWorldTransform().getOrigin()};
+            if (slabIndex(position) != i)
+                continue;
+
+            /* A parked body stays where it left the bounds, so it's still
+               in the slab until its pair is dropped */
+            auto *body = static_cast<RigidBody *>(object->getUserPointer());
+            if (body->isParked())
+                continue;
+
+            arrayAppend(out, body);
+        }
+    }
+}
+
+UnsignedInt KillVolume::slabIndex(const Vector3 &position) const {
+    for (UnsignedInt axis = 0; axis != 3; ++axis) {
+        if (position[axis] < _bounds.min()[axis])
+            return axis * 2;
+        if (position[axis] > _bounds.max()[axis])
+            return axis * 2 + 1;
+    }
+    return 6;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Range.h>
+#include <btBulletDynamicsCommon.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class RigidBody;
+
+/* Everything outside of given bounds, as six slabs of ghost objects in the
+   broadphase of a world. Bodies entering a slab become overlapping pairs
+   the broadphase maintains while stepping anyway, so finding bodies that
+   left the bounds costs time proportional to the bodies in the slabs rather
+   than all bodies. Static bodies are ignored. */
+class KillVolume {
+ public:
+    /* Sets up the pair callback of the world's pair cache, so there can't
+       be other ghost objects in the world */
+    explicit KillVolume(btCollisionWorld &bWorld, const Range3D &bounds);
+
+    /* Removes the slabs from the world */
+    ~KillVolume();
+
+    KillVolume(const KillVolume &) = delete;
+    KillVolume &operator=(const KillVolume &) = delete;
+
+    const Range3D &bounds() const;
+
+    /* The slabs overlap the new bounds after the next step */
+    void setBounds(const Range3D &bounds);
+
+    /* Appends bodies with the center outside of the bounds to given array,
+       each once. Based on the pairs from the last step, so a body gets
+       there one step after leaving. Parked bodies are skipped. */
+    void collect(Containers::Array<RigidBody *> &out) const;
+
+ private:
+    /* Index of the slab given position is in, the first of -X, +X, -Y, +Y,
+       -Z, +Z, or 6 if it's inside the bounds */
+    UnsignedInt slabIndex(const Vector3 &position) const;
+
+    btCollisionWorld &_bWorld;
+    Range3D _bounds;
+    btGhostPairCallback _bGhostPairCallback;
+    Containers::Pointer<btBoxShape> _bShapes[6];
+    btGhostObject _bGhosts[6];
+};
+
+}  // namespace GraphicsPlayground
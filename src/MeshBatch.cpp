@@ -0,0 +1,374 @@
+#include "MeshBatch.h"
+
+#include "CompactPhongGL.h"
+#include "InstanceStore.h"
+#include "Profiler.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/MeshView.h>
+#include <Magnum/GL/TextureFormat.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/Trade/MeshData.h>
+#ifdef MAGNUM_TARGET_WEBGL
+#include <webgl/webgl1_ext.h>
+#endif
+
+namespace GraphicsPlayground {
+
+namespace {
+
+/* Two texels per instance */
+constexpr std::size_t InstancesPerRow =
+    CompactPhongGL::InstanceTextureWidth / 2;
+
+static_assert(sizeof(CompactInstanceData) == 2 * 4 * sizeof(UnsignedInt),
+              "an instance has to be exactly two RGBA32UI texels");
+
+}  // namespace
+
+MeshBatch::MeshBatch(NoCreateT) noexcept {}
+
+MeshBatch::MeshBatch()
+    : _vertices{GL::Buffer::TargetHint::Array},
+      _indices{GL::Buffer::TargetHint::ElementArray} {
+    _mesh = GL::Mesh{};
+    _mesh.setPrimitive(GL::MeshPrimitive::Triangles)
+        .addVertexBuffer(_vertices, 0, CompactPhongGL::Position{},
+                         CompactPhongGL::Normal{})
+        .setIndexBuffer(_indices, 0, GL::MeshIndexType::UnsignedInt);
+
+    const Vector2i maxTextureSize = GL::Texture2D::maxSize();
+    const Int width = Int(CompactPhongGL::InstanceTextureWidth);
+    CORRADE_ASSERT(maxTextureSize.x() >= width,
+                   "MeshBatch: the instance texture needs a width of"
+                       << width << "but the GPU supports at most"
+                       << maxTextureSize.x(), );
+    _maxTextureRows = maxTextureSize.y();
+}
+
+bool MeshBatch::isMultiDrawSupported() {
+#ifdef MAGNUM_TARGET_WEBGL
+    return GL::Context::current()
+        .isExtensionSupported<GL::Extensions::WEBGL::multi_draw>();
+#elif defined(MAGNUM_TARGET_GLES)
+    return GL::Context::current()
+        .isExtensionSupported<GL::Extensions::ANGLE::multi_draw>();
+#else
+    /* Desktop GL has no instanced multi-draw with gl_DrawID short of
+       indirect draws, the draws are done one by one */
+    return false;
+#endif
+}
+
+UnsignedInt MeshBatch::addMesh(const Trade::MeshData &meshData) {
+    CORRADE_ASSERT(meshData.isIndexed() &&
+                       meshData.primitive() == MeshPrimitive::Triangles,
+                   "MeshBatch::addMesh(): expected an indexed triangle mesh",
+                   {});
+
+    /* No base vertex in WebGL 2, the indices point to the vertices of the
+       mesh in the shared buffer directly */
+    const UnsignedInt vertexOffset = UnsignedInt(_vertexData.size());
+    const Containers::Array<Vector3> positions = meshData.positions3DAsArray();
+    const Containers::Array<Vector3> normals = meshData.normalsAsArray();
+    for (std::size_t i = 0; i != positions.size(); ++i)
+        arrayAppend(_vertexData, Vertex{positions[i], normals[i]});
+
+    const Mesh mesh{UnsignedInt(_indexData.size()),
+                    UnsignedInt(meshData.indexCount())};
+    for (const UnsignedInt index : meshData.indicesAsArray())
+        arrayAppend(_indexData, vertexOffset + index);
+
+    arrayAppend(_meshes, mesh);
+    _geometryDirty = true;
+    return UnsignedInt(_meshes.size() - 1);
+}
+
+std::size_t MeshBatch::meshCount() const {
+    return _meshes.size();
+}
+
+std::size_t MeshBatch::triangleCount(UnsignedInt mesh) const {
+    return _meshes[mesh].indexCount / 3;
+}
+
+void MeshBatch::clear() {
+    arrayResize(_instances, 0);
+    arrayResize(_draws, 0);
+    arrayResize(_staticDraws, 0);
+}
+
+void MeshBatch::addDraw(
+    UnsignedInt mesh,
+    Containers::ArrayView<const CompactInstanceData> instances) {
+    CORRADE_ASSERT(mesh < _meshes.size(),
+                   "MeshBatch::addDraw(): mesh" << mesh << "out of range for"
+                                                << _meshes.size() << "meshes",
+                   );
+    if (instances.isEmpty())
+        return;
+
+    arrayAppend(_draws, Draw{mesh, UnsignedInt(_instances.size()),
+                             UnsignedInt(instances.size())});
+    arrayAppend(_instances, instances);
+}
+
+UnsignedInt MeshBatch::addStaticRegion() {
+    arrayAppend(_staticRegions, StaticRegion{});
+    return UnsignedInt(_staticRegions.size() - 1);
+}
+
+void MeshBatch::updateStaticRegion(UnsignedInt region,
+                                   const InstanceStore &store) {
+    CORRADE_ASSERT(region < _staticRegions.size(),
+                   "MeshBatch::updateStaticRegion(): region"
+                       << region << "out of range for"
+                       << _staticRegions.size() << "regions", );
+    StaticRegion &staticRegion = _staticRegions[region];
+
+    /* The dirty ranges are relative to the previous update, if the store
+       was updated more than once since the last upload, everything has to
+       be uploaded again */
+    bool uploadAll = store.updateCount() - staticRegion.updateCount > 1;
+    const bool uploadRanges = store.updateCount() != staticRegion.updateCount;
+    staticRegion.instanceCount = store.staticCount();
+    staticRegion.updateCount = store.updateCount();
+
+    /* Unlike a buffer, the texture storage is immutable, so growing it
+       means a new texture, which doesn't have any of the contents */
+    const Int rows = Int((staticRegion.instanceCount + InstancesPerRow - 1) /
+                         InstancesPerRow);
+    if (rows > staticRegion.textureRows) {
+        staticRegion.textureRows =
+            grownTextureRows(rows, staticRegion.textureRows);
+        staticRegion.texture = GL::Texture2D{};
+        staticRegion.texture.setMinificationFilter(GL::SamplerFilter::Nearest)
+            .setMagnificationFilter(GL::SamplerFilter::Nearest)
+            .setStorage(1, GL::TextureFormat::RGBA32UI,
+                        {Int(CompactPhongGL::InstanceTextureWidth),
+                         staticRegion.textureRows});
+        ++_reallocations;
+        uploadAll = true;
+    }
+
+    if (uploadAll) {
+        if (rows)
+            uploadStaticRows(staticRegion, store, 0, rows);
+    } else if (uploadRanges) {
+        /* The texture is updated in whole rows, a row shared by several
+           ranges is uploaded just once */
+        Int uploadedRows = 0;
+        for (const Range1Di &range : store.staticUpdates()) {
+            const Int first =
+                Math::max(Int(range.min() / InstancesPerRow), uploadedRows);
+            const Int last = Math::min(
+                Int((range.max() + InstancesPerRow - 1) / InstancesPerRow),
+                rows);
+            if (first >= last)
+                continue;
+            uploadStaticRows(staticRegion, store, first, last);
+            uploadedRows = last;
+        }
+    }
+}
+
+Int MeshBatch::grownTextureRows(Int rows, Int currentRows) const {
+    CORRADE_ASSERT(rows <= _maxTextureRows,
+                   "MeshBatch: instances need" << rows
+                       << "texture rows but the GPU supports at most"
+                       << _maxTextureRows, {});
+    return Math::min(Math::max(rows, 2 * currentRows), _maxTextureRows);
+}
+
+void MeshBatch::uploadStaticRows(StaticRegion &region,
+                                 const InstanceStore &store, const Int first,
+                                 const Int last) {
+    const std::size_t begin = first * InstancesPerRow;
+    const std::size_t end =
+        Math::min(last * InstancesPerRow, region.instanceCount);
+    arrayResize(_staticData, NoInit, end - begin);
+    store.fillInstanceData(_staticData, begin);
+
+    /* The rest of the last row is padding */
+    arrayResize(_staticData, ValueInit, (last - first) * InstancesPerRow);
+    PLAYGROUND_PROFILE(Upload);
+    region.texture.setSubImage(
+        0, {0, first},
+        ImageView2D{PixelFormat::RGBA32UI,
+                    {Int(CompactPhongGL::InstanceTextureWidth), last - first},
+                    _staticData});
+    _uploadedBytes += _staticData.size() * sizeof(CompactInstanceData);
+}
+
+void MeshBatch::addStaticDraw(UnsignedInt mesh, UnsignedInt region) {
+    CORRADE_ASSERT(mesh < _meshes.size(),
+                   "MeshBatch::addStaticDraw(): mesh"
+                       << mesh << "out of range for" << _meshes.size()
+                       << "meshes", );
+    CORRADE_ASSERT(region < _staticRegions.size(),
+                   "MeshBatch::addStaticDraw(): region"
+                       << region << "out of range for"
+                       << _staticRegions.size() << "regions", );
+    const std::size_t count = _staticRegions[region].instanceCount;
+    if (!count)
+        return;
+
+    arrayAppend(_staticDraws,
+                StaticDraw{region, Draw{mesh, 0, UnsignedInt(count)}});
+}
+
+void MeshBatch::draw(CompactPhongGL &shader) {
+    CORRADE_ASSERT(shader.flags() & CompactPhongGL::Flag::InstanceTexture,
+                   "MeshBatch::draw(): expected a shader with an instance "
+                   "texture", );
+
+    _drawCount = _draws.size() + _staticDraws.size();
+    _drawCallCount = 0;
+    if (!_drawCount)
+        return;
+
+    if (_geometryDirty) {
+        _vertices.setData(_vertexData);
+        _indices.setData(_indexData);
+        _geometryDirty = false;
+    }
+
+    /* Each region has a texture of its own, so its draws can't be part of
+       the same multi-draw as the rest */
+    for (const StaticDraw &draw : _staticDraws) {
+        shader.bindInstanceTexture(_staticRegions[draw.region].texture);
+        submit(shader, {&draw.draw, 1});
+    }
+
+    if (_draws.isEmpty())
+        return;
+
+    /* The texture is uploaded in whole rows, the rest of the last one is
+       padding. Like InstanceStream, each frame writes to the texture
+       following the previous one, and textures grow geometrically. */
+    const Int rows =
+        Int((_instances.size() + InstancesPerRow - 1) / InstancesPerRow);
+    arrayResize(_instances, ValueInit, rows * InstancesPerRow);
+    _slot = (_slot + 1) % SlotCount;
+    GL::Texture2D &texture = _textures[_slot];
+    if (rows > _textureRows[_slot]) {
+        _textureRows[_slot] = grownTextureRows(rows, _textureRows[_slot]);
+        texture = GL::Texture2D{};
+        texture.setMinificationFilter(GL::SamplerFilter::Nearest)
+            .setMagnificationFilter(GL::SamplerFilter::Nearest)
+            .setStorage(1, GL::TextureFormat::RGBA32UI,
+                        {Int(CompactPhongGL::InstanceTextureWidth),
+                         _textureRows[_slot]});
+        ++_reallocations;
+    }
+    {
+        PLAYGROUND_PROFILE(Upload);
+        texture.setSubImage(
+            0, {},
+            ImageView2D{PixelFormat::RGBA32UI,
+                        {Int(CompactPhongGL::InstanceTextureWidth), rows},
+                        _instances});
+    }
+    _uploadedBytes += _instances.size() * sizeof(CompactInstanceData);
+    shader.bindInstanceTexture(texture);
+    submit(shader, _draws);
+}
+
+void MeshBatch::submit(CompactPhongGL &shader,
+                       const Containers::ArrayView<const Draw> draws) {
+    /* The shader has room for offsets of a limited number of draws, more
+       than that are split into several multi-draws */
+    const bool multiDraw = shader.flags() >= CompactPhongGL::Flag::MultiDraw;
+    for (std::size_t first = 0; first < draws.size();
+         first += CompactPhongGL::MaxDraws) {
+        const std::size_t count = Math::min(
+            draws.size() - first, std::size_t(CompactPhongGL::MaxDraws));
+        const Containers::ArrayView<const Draw> group =
+            draws.slice(first, first + count);
+
+        UnsignedInt instanceOffsets[CompactPhongGL::MaxDraws];
+        for (std::size_t i = 0; i != count; ++i)
+            instanceOffsets[i] = group[i].instanceOffset;
+        shader.setInstanceOffsets({instanceOffsets, count});
+
+#ifdef MAGNUM_TARGET_GLES
+        if (multiDraw) {
+            GLsizei counts[CompactPhongGL::MaxDraws];
+            GLsizei instanceCounts[CompactPhongGL::MaxDraws];
+            const void *indexOffsets[CompactPhongGL::MaxDraws];
+            for (std::size_t i = 0; i != count; ++i) {
+                const Mesh &mesh = _meshes[group[i].mesh];
+                counts[i] = GLsizei(mesh.indexCount);
+                instanceCounts[i] = GLsizei(group[i].instanceCount);
+                indexOffsets[i] = reinterpret_cast<const void *>(
+                    std::size_t(mesh.indexOffset) * sizeof(UnsignedInt));
+            }
+
+            /* Magnum has no instanced multi-draw without base instances,
+               so it's done directly, with the state tracker told about
+               it */
+            GL::Context::current().resetState(
+                GL::Context::State::EnterExternal);
+            glUseProgram(shader.id());
+            glBindVertexArray(_mesh.id());
+#ifdef MAGNUM_TARGET_WEBGL
+            glMultiDrawElementsInstancedWEBGL(
+                GL_TRIANGLES, counts, GL_UNSIGNED_INT, indexOffsets,
+                instanceCounts, GLsizei(count));
+#else
+            glMultiDrawElementsInstancedANGLE(
+                GL_TRIANGLES, counts, GL_UNSIGNED_INT, indexOffsets,
+                instanceCounts, GLsizei(count));
+#endif
+            GL::Context::current().resetState(
+                GL::Context::State::ExitExternal);
+            ++_drawCallCount;
+            continue;
+        }
+#else
+        CORRADE_ASSERT(!multiDraw,
+                       "MeshBatch::draw(): multi-draw is not supported on "
+                       "desktop GL", );
+        static_cast<void>(multiDraw);
+#endif
+
+        for (std::size_t i = 0; i != count; ++i) {
+            const Mesh &mesh = _meshes[group[i].mesh];
+            GL::MeshView view{_mesh};
+            view.setCount(Int(mesh.indexCount))
+                .setIndexOffset(Int(mesh.indexOffset))
+                .setInstanceCount(Int(group[i].instanceCount));
+            shader.setDrawIndex(UnsignedInt(i)).draw(view);
+            ++_drawCallCount;
+        }
+    }
+}
+
+std::size_t MeshBatch::drawCount() const {
+    return _drawCount;
+}
+
+std::size_t MeshBatch::drawCallCount() const {
+    return _drawCallCount;
+}
+
+std::size_t MeshBatch::uploadedBytes() const {
+    return _uploadedBytes;
+}
+
+std::size_t MeshBatch::reallocations() const {
+    return _reallocations;
+}
+
+void MeshBatch::resetStatistics() {
+    _uploadedBytes = 0;
+    _reallocations = 0;
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "CompactInstanceData.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Trade/Trade.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class CompactPhongGL;
+class InstanceStore;
+
+/* All meshes packed into a single vertex and index buffer, drawn together
+   with instances of all of them from a single instance texture. WebGL 2
+   has neither a base vertex nor a base instance, so the indices of each
+   mesh are offset to its vertices in the shared buffer and each draw reads
+   its instances at an offset given by CompactPhongGL::setInstanceOffsets().
+
+   The draws of a frame are submitted through a single call of
+   ANGLE_multi_draw or WEBGL_multi_draw if available, and with one call
+   each otherwise. Static regions keep the static partition of a store
+   resident in a texture of their own, their draws are submitted
+   separately before the rest. */
+class MeshBatch {
+ public:
+    explicit MeshBatch(NoCreateT) noexcept;
+    explicit MeshBatch();
+
+    /* Whether the current context can draw with a single multi-draw call,
+       in which case the shader should be created with
+       CompactPhongGL::Flag::MultiDraw */
+    static bool isMultiDrawSupported();
+
+    /* Adds an indexed triangle mesh with positions and normals, returns its
+       ID. Other attributes are ignored. */
+    UnsignedInt addMesh(const Trade::MeshData &meshData);
+
+    std::size_t meshCount() const;
+    std::size_t triangleCount(UnsignedInt mesh) const;
+
+    /* Starts collecting the draws of a new frame */
+    void clear();
+
+    /* Adds a draw of given mesh with given instances. Draws of a mesh that
+       has no instances are skipped. */
+    void addDraw(UnsignedInt mesh,
+                 Containers::ArrayView<const CompactInstanceData> instances);
+
+    /* Adds a region for the static instances of a store, returns its ID */
+    UnsignedInt addStaticRegion();
+
+    /* Uploads what changed in the static partition of given store to the
+       region. Like the static buffer of InstancedMesh, only the rows with
+       ranges listed by InstanceStore::staticUpdates() are uploaded, unless
+       the store was updated more than once since the last call or the
+       region had to grow. Meant to be called every frame with the same
+       store, even if the region isn't drawn. */
+    void updateStaticRegion(UnsignedInt region, const InstanceStore &store);
+
+    /* Adds a draw of given mesh with all instances of the region. Skipped
+       if the region is empty. */
+    void addStaticDraw(UnsignedInt mesh, UnsignedInt region);
+
+    /* Uploads the instances collected since clear() and draws all of them,
+       with a single call when the shader has Flag::MultiDraw. Expects a
+       shader with CompactPhongGL::Flag::InstanceTexture. */
+    void draw(CompactPhongGL &shader);
+
+    /* Draws and GL draw calls submitted in the last draw() */
+    std::size_t drawCount() const;
+    std::size_t drawCallCount() const;
+
+    /* Counters since the last resetStatistics() */
+    std::size_t uploadedBytes() const;
+    std::size_t reallocations() const;
+    void resetStatistics();
+
+ private:
+    struct Vertex {
+        Vector3 position;
+        Vector3 normal;
+    };
+
+    struct Mesh {
+        /* In indices, not bytes */
+        UnsignedInt indexOffset, indexCount;
+    };
+
+    struct Draw {
+        UnsignedInt mesh, instanceOffset, instanceCount;
+    };
+
+    struct StaticRegion {
+        GL::Texture2D texture{NoCreate};
+        Int textureRows{};
+        /* Static instances and the store update they're current for */
+        std::size_t instanceCount{};
+        UnsignedInt updateCount{};
+    };
+
+    struct StaticDraw {
+        UnsignedInt region;
+        Draw draw;
+    };
+
+    /* Rows of a texture that grows to fit given rows, expects that they
+       fit into the maximal texture size */
+    Int grownTextureRows(Int rows, Int currentRows) const;
+
+    /* Uploads given rows of the region from the store */
+    void uploadStaticRows(StaticRegion &region, const InstanceStore &store,
+                          Int first, Int last);
+
+    /* Draws from the instance texture bound to the shader */
+    void submit(CompactPhongGL &shader,
+                Containers::ArrayView<const Draw> draws);
+
+    /* Geometry of all meshes, uploaded again at the next draw() when a
+       mesh is added */
+    Containers::Array<Vertex> _vertexData;
+    Containers::Array<UnsignedInt> _indexData;
+    Containers::Array<Mesh> _meshes;
+    bool _geometryDirty{};
+    GL::Buffer _vertices{NoCreate}, _indices{NoCreate};
+    GL::Mesh _mesh{NoCreate};
+
+    /* Instances and draws of the current frame. The instance textures are
+       used in a ring like the buffers in InstanceStream. */
+    enum : std::size_t { SlotCount = 3 };
+    Containers::Array<CompactInstanceData> _instances;
+    Containers::Array<Draw> _draws;
+    GL::Texture2D _textures[SlotCount]{
+        GL::Texture2D{NoCreate}, GL::Texture2D{NoCreate},
+        GL::Texture2D{NoCreate}};
+    Int _textureRows[SlotCount]{};
+    std::size_t _slot{};
+
+    /* Most rows an instance texture can have on this GPU */
+    Int _maxTextureRows{};
+
+    /* Resident static instances and their draws in the current frame */
+    Containers::Array<StaticRegion> _staticRegions;
+    Containers::Array<StaticDraw> _staticDraws;
+    Containers::Array<CompactInstanceData> _staticData;
+
+    std::size_t _drawCount{}, _drawCallCount{};
+    std::size_t _uploadedBytes{}, _reallocations{};
+};
+
+}  // namespace GraphicsPlayground
@@ -39,9 +39,12 @@ Vector3 clampLength(Vector3 vector, Float maxLength) {
 
 MovingSphere::MovingSphere(Object3D *parent, btCollisionShape *bShape,
                            btDynamicsWorld &bWorld)
-    : RigidBody(parent, 5.0f, bShape, bWorld) {}
+    : RigidBody(parent, 5.0f, bShape, bWorld) {
+    /* Controlled every tick, even when standing still */
+    rigidBody().forceActivationState(DISABLE_DEACTIVATION);
+}
 
-void MovingSphere::adjustVelocity(const Timeline &timeline,
+void MovingSphere::adjustVelocity(Float timeStep,
                                   const Matrix4 &playerInputSpace,
                                   const Vector3 &playerInput,
                                   const Vector3 &upAxis) {
@@ -59,8 +62,7 @@ void MovingSphere::adjustVelocity(const Timeline &timeline,
     adjustment.x() = playerInput.x() * speed - Math::dot(velocity, xAxis);
     adjustment.z() = playerInput.z() * speed - Math::dot(velocity, zAxis);
 
-    adjustment = clampLength(adjustment,
-                             acceleration * timeline.previousFrameDuration());
+    adjustment = clampLength(adjustment, acceleration * timeStep);
 
     velocity += xAxis * adjustment.x() + zAxis * adjustment.z();
 
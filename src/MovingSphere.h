@@ -3,7 +3,6 @@
 #include "Rigidbody.h"
 
 #include <Magnum/Math/Vector3.h>
-#include <Magnum/Timeline.h>
 
 namespace GraphicsPlayground {
 
@@ -14,8 +13,9 @@ class MovingSphere : public RigidBody {
     MovingSphere(Object3D *parent, btCollisionShape *bShape,
                  btDynamicsWorld &bWorld);
 
-    void adjustVelocity(const Timeline &timeline,
-                        const Matrix4 &playerInputSpace,
+    /* Moves the velocity towards the player input by at most the maximal
+       acceleration over given time step */
+    void adjustVelocity(Float timeStep, const Matrix4 &playerInputSpace,
                         const Vector3 &playerInput, const Vector3 &upAxis);
     void jump(const Vector3 &gravity, const Vector3 &upAxis);
 };
@@ -0,0 +1,285 @@
+#include "OcclusionCuller.h"
+
+#include "Simd.h"
+
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Vector4.h>
+
+#include <algorithm>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+constexpr Int TileSize = 8;
+
+/* Clip-space w below which a point is treated as being at or behind the
+   camera */
+constexpr Float MinW = 1.0e-4f;
+
+/* Offsets of the lanes of a pack, enough for the widest one */
+constexpr Float LaneOffsets[8]{0.0f, 1.0f, 2.0f, 3.0f,
+                               4.0f, 5.0f, 6.0f, 7.0f};
+
+static_assert(TileSize % Simd::Width == 0,
+              "tile rows have to consist of whole packs");
+
+/* Coefficients of the edge function A*x + B*y + C, which is positive on
+   the left side of the edge from a to b */
+struct Edge {
+    Edge(const Vector3 &from, const Vector3 &to)
+        : a{from.y() - to.y()}, b{to.x() - from.x()},
+          c{-a * from.x() - b * from.y()} {}
+
+    Float at(Float x, Float y) const {
+        return a * x + b * y + c;
+    }
+
+    Float a, b, c;
+};
+
+}  // namespace
+
+OcclusionCuller::OcclusionCuller(const Vector2i &size)
+    : _size{(Math::max(size, Vector2i{1}) + Vector2i{TileSize - 1}) /
+            TileSize * TileSize},
+      _depth{NoInit, std::size_t(_size.product())},
+      _tileDepth{NoInit, std::size_t(_size.product() / (TileSize * TileSize))} {
+    clear(Matrix4{});
+}
+
+Vector2i OcclusionCuller::size() const {
+    return _size;
+}
+
+void OcclusionCuller::clear(const Matrix4 &projectionCameraMatrix) {
+    _projectionCameraMatrix = projectionCameraMatrix;
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+    std::fill(_tileDepth.begin(), _tileDepth.end(), 1.0f);
+}
+
+void OcclusionCuller::addOccluder(
+    Containers::ArrayView<const Vector3> positions,
+    Containers::ArrayView<const UnsignedInt> indices,
+    const Matrix4 &transformation) {
+    CORRADE_ASSERT(indices.size() % 3 == 0,
+                   "OcclusionCuller::addOccluder(): expected triangles but got"
+                       << indices.size() << "indices", );
+
+    const Matrix4 matrix = _projectionCameraMatrix * transformation;
+    const Vector2 size{_size};
+    Vector2i min{_size}, max{-1};
+    for (std::size_t i = 0; i != indices.size(); i += 3) {
+        Vector3 screen[3];
+        bool behind = false;
+        for (std::size_t j = 0; j != 3; ++j) {
+            const Vector4 clip =
+                matrix * Vector4{positions[indices[i + j]], 1.0f};
+            if (clip.w() < MinW) {
+                behind = true;
+                break;
+            }
+
+            /* Pixel coordinates and depth in [0, 1] */
+            const Vector3 ndc = clip.xyz() / clip.w();
+            screen[j] = Vector3{(ndc.xy() * 0.5f + Vector2{0.5f}) * size,
+                                ndc.z() * 0.5f + 0.5f};
+        }
+        if (behind)
+            continue;
+
+        rasterizeTriangle(screen[0], screen[1], screen[2]);
+        for (const Vector3 &vertex : screen) {
+            min = Math::min(min, Vector2i{Math::floor(vertex.xy())});
+            max = Math::max(max, Vector2i{Math::ceil(vertex.xy())});
+        }
+    }
+
+    updateTiles(Math::max(min, Vector2i{0}),
+                Math::min(max, _size - Vector2i{1}));
+}
+
+void OcclusionCuller::rasterizeTriangle(const Vector3 &a, const Vector3 &b,
+                                        const Vector3 &c) {
+    /* Make the winding counterclockwise, so all edge functions are
+       positive inside. Degenerate triangles cover nothing. */
+    Float area = Edge{a, b}.at(c.x(), c.y());
+    if (area == 0.0f)
+        return;
+    const Vector3 &v0 = a;
+    const Vector3 &v1 = area > 0.0f ? b : c;
+    const Vector3 &v2 = area > 0.0f ? c : b;
+    area = Math::abs(area);
+
+    /* Pixels with the center inside, clamped to the buffer. The first
+       column is aligned down to a whole pack, as the width is a multiple
+       of the tile size. */
+    const Int minX = Math::max(
+        Int(Math::floor(Math::min(Math::min(v0.x(), v1.x()), v2.x()))), 0);
+    const Int maxX = Math::min(
+        Int(Math::ceil(Math::max(Math::max(v0.x(), v1.x()), v2.x()))),
+        _size.x() - 1);
+    const Int minY = Math::max(
+        Int(Math::floor(Math::min(Math::min(v0.y(), v1.y()), v2.y()))), 0);
+    const Int maxY = Math::min(
+        Int(Math::ceil(Math::max(Math::max(v0.y(), v1.y()), v2.y()))),
+        _size.y() - 1);
+    if (minX > maxX || minY > maxY)
+        return;
+    const Int alignedMinX = minX / Int(Simd::Width) * Int(Simd::Width);
+
+    /* The edge opposite to a vertex is proportional to its barycentric
+       coordinate, which interpolates the depth */
+    const Edge e12{v1, v2}, e20{v2, v0}, e01{v0, v1};
+    const Float depth1 = (v1.z() - v0.z()) / area;
+    const Float depth2 = (v2.z() - v0.z()) / area;
+
+    const Simd::Pack zero = Simd::splat(0.0f);
+    const Simd::Pack lanes = Simd::load(LaneOffsets);
+    const Simd::Pack e12Step = Simd::mul(Simd::splat(e12.a), lanes);
+    const Simd::Pack e20Step = Simd::mul(Simd::splat(e20.a), lanes);
+    const Simd::Pack e01Step = Simd::mul(Simd::splat(e01.a), lanes);
+    const Simd::Pack v0Depth = Simd::splat(v0.z());
+    const Simd::Pack depth1Factor = Simd::splat(depth1);
+    const Simd::Pack depth2Factor = Simd::splat(depth2);
+
+    for (Int y = minY; y <= maxY; ++y) {
+        Float *row = _depth.data() + std::size_t(y) * _size.x();
+        const Float py = y + 0.5f;
+        for (Int x = alignedMinX; x <= maxX; x += Int(Simd::Width)) {
+            const Float px = x + 0.5f;
+            const Simd::Pack w0 =
+                Simd::add(Simd::splat(e12.at(px, py)), e12Step);
+            const Simd::Pack w1 =
+                Simd::add(Simd::splat(e20.at(px, py)), e20Step);
+            const Simd::Pack w2 =
+                Simd::add(Simd::splat(e01.at(px, py)), e01Step);
+            const Simd::Mask outside =
+                Simd::either(Simd::either(Simd::less(w0, zero),
+                                          Simd::less(w1, zero)),
+                             Simd::less(w2, zero));
+
+            const Simd::Pack depth =
+                Simd::add(v0Depth, Simd::add(Simd::mul(w1, depth1Factor),
+                                             Simd::mul(w2, depth2Factor)));
+            const Simd::Pack old = Simd::load(row + x);
+            Simd::store(row + x,
+                        Simd::select(outside, old, Simd::min(old, depth)));
+        }
+    }
+}
+
+void OcclusionCuller::updateTiles(const Vector2i &min, const Vector2i &max) {
+    const Int tilesX = _size.x() / TileSize;
+    for (Int ty = min.y() / TileSize; ty <= max.y() / TileSize; ++ty) {
+        for (Int tx = min.x() / TileSize; tx <= max.x() / TileSize; ++tx) {
+            Simd::Pack farthest = Simd::splat(0.0f);
+            for (Int y = ty * TileSize; y != (ty + 1) * TileSize; ++y) {
+                const Float *row = _depth.data() +
+                                   std::size_t(y) * _size.x() + tx * TileSize;
+                for (Int x = 0; x != TileSize; x += Int(Simd::Width))
+                    farthest = Simd::max(farthest, Simd::load(row + x));
+            }
+
+            Float lanes[Simd::Width];
+            Simd::store(lanes, farthest);
+            _tileDepth[std::size_t(ty) * tilesX + tx] =
+                *std::max_element(lanes, lanes + Simd::Width);
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const Vector3 &center, Float radius) const {
+    /* Corners of the bounding box of the sphere in clip space, without
+       doing eight full matrix multiplications */
+    const Vector4 clipCenter = _projectionCameraMatrix * Vector4{center, 1.0f};
+    const Vector4 axes[3]{_projectionCameraMatrix[0] * radius,
+                          _projectionCameraMatrix[1] * radius,
+                          _projectionCameraMatrix[2] * radius};
+    Vector2 min{Constants::inf()}, max{-Constants::inf()};
+    Float nearest = Constants::inf();
+    for (Int i = 0; i != 8; ++i) {
+        const Vector4 clip = clipCenter + (i & 1 ? axes[0] : -axes[0]) +
+                             (i & 2 ? axes[1] : -axes[1]) +
+                             (i & 4 ? axes[2] : -axes[2]);
+        /* Reaches behind the camera, can't be occluded */
+        if (clip.w() < MinW)
+            return true;
+
+        const Vector3 ndc = clip.xyz() / clip.w();
+        min = Math::min(min, ndc.xy());
+        max = Math::max(max, ndc.xy());
+        nearest = Math::min(nearest, ndc.z());
+    }
+    nearest = nearest * 0.5f + 0.5f;
+    if (nearest <= 0.0f)
+        return true;
+
+    /* Outside of the buffer is the frustum culler's job */
+    const Vector2 size{_size};
+    const Vector2i minPixel{Math::floor((min * 0.5f + Vector2{0.5f}) * size)};
+    const Vector2i maxPixel{Math::floor((max * 0.5f + Vector2{0.5f}) * size)};
+    if ((maxPixel < Vector2i{0}).any() || (minPixel >= _size).any())
+        return true;
+    const Vector2i first = Math::max(minPixel, Vector2i{0});
+    const Vector2i last = Math::min(maxPixel, _size - Vector2i{1});
+
+    /* Tiles farther than the sphere don't need their pixels checked */
+    const Int tilesX = _size.x() / TileSize;
+    bool tilesOccluded = true;
+    for (Int ty = first.y() / TileSize;
+         tilesOccluded && ty <= last.y() / TileSize; ++ty)
+        for (Int tx = first.x() / TileSize; tx <= last.x() / TileSize; ++tx)
+            if (_tileDepth[std::size_t(ty) * tilesX + tx] >= nearest) {
+                tilesOccluded = false;
+                break;
+            }
+    if (tilesOccluded)
+        return false;
+
+    /* Otherwise it's visible if any pixel in the bounds isn't nearer */
+    const Simd::Pack sphereDepth = Simd::splat(nearest);
+    const Simd::Pack lanes = Simd::load(LaneOffsets);
+    const Simd::Pack firstX = Simd::splat(first.x() - 0.5f);
+    const Simd::Pack lastX = Simd::splat(last.x() + 0.5f);
+    const Int alignedFirstX = first.x() / Int(Simd::Width) * Int(Simd::Width);
+    for (Int y = first.y(); y <= last.y(); ++y) {
+        const Float *row = _depth.data() + std::size_t(y) * _size.x();
+        for (Int x = alignedFirstX; x <= last.x(); x += Int(Simd::Width)) {
+            const Simd::Pack column = Simd::add(Simd::splat(Float(x)), lanes);
+            const Simd::Mask inside = Simd::both(Simd::greater(column, firstX),
+                                                 Simd::less(column, lastX));
+            const Simd::Mask visible = Simd::andNot(
+                inside, Simd::less(Simd::load(row + x), sphereDepth));
+            if (Simd::bits(visible))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+std::size_t OcclusionCuller::cull(Containers::ArrayView<const Vector3> centers,
+                                  Containers::ArrayView<const Float> scales,
+                                  Float radius,
+                                  Containers::ArrayView<UnsignedInt> indices)
+    const {
+    CORRADE_ASSERT(centers.size() == scales.size(),
+                   "OcclusionCuller::cull(): expected"
+                       << centers.size() << "scales but got"
+                       << scales.size(),
+                   {});
+
+    std::size_t visibleCount = 0;
+    for (const UnsignedInt index : indices)
+        if (isVisible(centers[index], scales[index] * radius))
+            indices[visibleCount++] = index;
+    return visibleCount;
+}
+
+Containers::ArrayView<const Float> OcclusionCuller::depth() const {
+    return _depth;
+}
+
+}  // namespace GraphicsPlayground
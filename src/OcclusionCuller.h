@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Vector2.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Software occlusion culling on the CPU. A few large occluders are
+   rasterized into a small depth buffer, then bounding spheres are tested
+   against it, first against the farthest depth of each 8x8 tile and only
+   then pixel by pixel. Rasterization and the pixel tests are done a Simd
+   pack at a time. Doesn't need a GPU, so it works headless as well.
+
+   The depth buffer keeps the nearest occluder depth, normalized to
+   [0, 1]. A sphere is occluded if its nearest point is behind the
+   occluders in all pixels its screen-space bounds cover. */
+class OcclusionCuller {
+ public:
+    /* The size is rounded up to a multiple of the tile size */
+    explicit OcclusionCuller(const Vector2i &size = {256, 128});
+
+    Vector2i size() const;
+
+    /* Clears the depth buffer and sets the matrix occluders and spheres
+       are projected with */
+    void clear(const Matrix4 &projectionCameraMatrix);
+
+    /* Rasterizes an indexed triangle mesh, with vertex positions
+       transformed by given matrix first. Triangles crossing the near plane
+       are skipped, which makes the occluder smaller but never wrong. */
+    void addOccluder(Containers::ArrayView<const Vector3> positions,
+                     Containers::ArrayView<const UnsignedInt> indices,
+                     const Matrix4 &transformation);
+
+    bool isVisible(const Vector3 &center, Float radius) const;
+
+    /* Keeps only indices of visible spheres in given view, moving them to
+       its front, and returns their count. Radius of each sphere is its
+       scale multiplied by the radius parameter. */
+    std::size_t cull(Containers::ArrayView<const Vector3> centers,
+                     Containers::ArrayView<const Float> scales, Float radius,
+                     Containers::ArrayView<UnsignedInt> indices) const;
+
+    /* Depth of each pixel, row by row from the bottom */
+    Containers::ArrayView<const Float> depth() const;
+
+ private:
+    void rasterizeTriangle(const Vector3 &a, const Vector3 &b,
+                           const Vector3 &c);
+    void updateTiles(const Vector2i &min, const Vector2i &max);
+
+    Vector2i _size;
+    Matrix4 _projectionCameraMatrix;
+    Containers::Array<Float> _depth;
+    /* Farthest depth in each tile */
+    Containers::Array<Float> _tileDepth;
+};
+
+}  // namespace GraphicsPlayground
@@ -18,6 +18,7 @@ constexpr const Float MinVerticalAngle = -45.0f, MaxVerticalAngle = 60.0f;
 
 constexpr const Float AlignDelay = 5.0f;
 constexpr const Float AlignSmoothRange = 45.0f;
+constexpr const Float AlignReferenceFrameDuration = 1.0f / 60.0f;
 
 constexpr const Float UpAlignmentSpeed = 360.0f;
 
@@ -137,9 +138,18 @@ bool OrbitCamera::automaticRotation(const Timeline &timeline) {
     if (timeline.previousFrameTime() - lastManualRotationTime < AlignDelay) {
         return false;
     }
+    const Float frameDuration = timeline.previousFrameDuration();
+    if (frameDuration <= 0.0f) {
+        return false;
+    }
+
+    /* The movement is scaled to what it would be in a frame of the
+       reference duration, so the camera turns the same regardless of the
+       frame rate */
     Vector3 alignedDelta =
         gravityAlignment.inverted().transformVectorNormalized(
-            (focusPoint - previousFocusPoint));
+            (focusPoint - previousFocusPoint)) *
+        (AlignReferenceFrameDuration / frameDuration);
     Vector2 movement{alignedDelta.x(), alignedDelta.z()};
     Float movementDeltaSqr = movement.dot();
     if (movementDeltaSqr < 0.0001f) {
@@ -149,8 +159,8 @@ bool OrbitCamera::automaticRotation(const Timeline &timeline) {
     Float headingAngle = getAngle(movement / Math::sqrt(movementDeltaSqr));
     Float deltaAbs = Math::abs(deltaAngle(orbitAngles.y(), headingAngle));
     Float rotationChange =
-        RotationSpeed *
-        Math::min(timeline.previousFrameDuration(), movementDeltaSqr);
+        RotationSpeed * frameDuration *
+        Math::min(1.0f, movementDeltaSqr / AlignReferenceFrameDuration);
     if (deltaAbs < AlignSmoothRange) {
         rotationChange *= deltaAbs / AlignSmoothRange;
     } else if (180.0f - deltaAbs < AlignSmoothRange) {
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Counters of the Bullet world after the last step, together with what
+   Bullet's own profiler measured in it */
+struct PhysicsStatistics {
+    /* A scope of Bullet's profiler. The scopes are in depth-first order,
+       the name is a string literal owned by Bullet. */
+    struct ProfileScope {
+        const char *name;
+        Int depth;
+        Int calls;
+        Float milliseconds;
+    };
+
+    /* Empty if Bullet is built with BT_NO_PROFILE */
+    Containers::Array<ProfileScope> profile;
+
+    /* Pairs of overlapping bounding boxes found by the broadphase, the
+       contact manifolds of those actually touching and their points */
+    Int overlappingPairs{}, manifolds{}, contactPoints{};
+
+    /* Islands of bodies touching each other, awake or sleeping, and the
+       body count of the largest one */
+    Int islands{}, largestIsland{};
+
+    /* Dynamic bodies being simulated, asleep with their island and taken
+       out of the simulation, such as boxes parked in their pool */
+    Int activeBodies{}, sleepingBodies{}, disabledBodies{};
+
+    /* Constraint solver iterations done in every substep */
+    Int solverIterations{};
+
+    /* Substeps the last step took, substeps it would have needed to catch
+       up with its time step and the limit they got clamped to */
+    Int substeps{}, requestedSubSteps{}, maxSubSteps{};
+
+    /* Frames Simulation::runTicks() dropped time of so far, because they
+       were longer than the max frame duration */
+    UnsignedLong clampedFrames{};
+};
+
+}  // namespace GraphicsPlayground
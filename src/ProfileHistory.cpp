@@ -0,0 +1,60 @@
+#include "ProfileHistory.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace GraphicsPlayground {
+
+void ProfileHistory::nextFrame() {
+    /* The slot of the oldest frame is reused for the new one */
+    const std::size_t slot = _frame % FrameCount;
+    _frameEnds[slot] = Profiler::now();
+    for (Float(&durations)[FrameCount] : _durations)
+        durations[slot] = 0.0f;
+
+    arrayResize(_events, 0);
+    Profiler::read(_positions, _events);
+    for (const ProfileEvent &event : _events)
+        _durations[std::size_t(event.phase)][slot] +=
+            Float(event.end - event.begin) * 1.0e-6f;
+    ++_frame;
+
+    /* Nearest rank, over the frames there were so far */
+    const std::size_t count = Math::min(_frame, std::size_t(FrameCount));
+    const std::size_t rank = std::size_t(std::ceil(0.99 * Double(count)));
+    Float sorted[FrameCount];
+    for (std::size_t phase = 0; phase != ProfilePhaseCount; ++phase) {
+        std::copy(_durations[phase], _durations[phase] + count, sorted);
+        std::sort(sorted, sorted + count);
+        _p99[phase] = sorted[Math::max(rank, std::size_t{1}) - 1];
+        _max[phase] = sorted[count - 1];
+    }
+}
+
+Containers::ArrayView<const Float>
+ProfileHistory::durations(ProfilePhase phase) const {
+    return _durations[std::size_t(phase)];
+}
+
+std::size_t ProfileHistory::offset() const {
+    return _frame % FrameCount;
+}
+
+Float ProfileHistory::p99(ProfilePhase phase) const {
+    return _p99[std::size_t(phase)];
+}
+
+Float ProfileHistory::max(ProfilePhase phase) const {
+    return _max[std::size_t(phase)];
+}
+
+UnsignedLong ProfileHistory::frameStart(std::size_t framesAgo) const {
+    if (framesAgo >= Math::min(_frame, std::size_t(FrameCount)))
+        return 0;
+    return _frameEnds[(_frame - framesAgo - 1) % FrameCount];
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Profiler.h"
+
+#ifdef PLAYGROUND_PROFILER
+namespace GraphicsPlayground {
+
+/* Time spent in each phase per frame over the last FrameCount frames,
+   aggregated from the events of all threads. An event counts towards the
+   frame it ended in, so phases running on other threads, like the
+   simulation steps, show up in the frame they finished in. */
+class ProfileHistory {
+ public:
+    enum : std::size_t { FrameCount = 240 };
+
+    /* Ends the current frame, taking the events recorded since the last
+       call */
+    void nextFrame();
+
+    /* Milliseconds spent in given phase in the past frames, oldest first
+       starting at offset() and wrapping around */
+    Containers::ArrayView<const Float> durations(ProfilePhase phase) const;
+    std::size_t offset() const;
+
+    /* 99th percentile and maximum of the durations above */
+    Float p99(ProfilePhase phase) const;
+    Float max(ProfilePhase phase) const;
+
+    /* Profiler::now() at the start of the frame given count of frames ago,
+       or zero if there weren't that many yet */
+    UnsignedLong frameStart(std::size_t framesAgo) const;
+
+ private:
+    Containers::Array<UnsignedLong> _positions;
+    Containers::Array<ProfileEvent> _events;
+    Float _durations[ProfilePhaseCount][FrameCount]{};
+    Float _p99[ProfilePhaseCount]{}, _max[ProfilePhaseCount]{};
+    /* End of each of the frames, in the same order as the durations */
+    UnsignedLong _frameEnds[FrameCount]{};
+    std::size_t _frame{};
+};
+
+}  // namespace GraphicsPlayground
+#endif
@@ -0,0 +1,173 @@
+#include "Profiler.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Math/Functions.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+const char *const PhaseNames[]{
+    "Frame",     "Housekeeping", "Step",   "Gravity",    "Ball controls",
+    "Camera",    "Instances",    "Upload", "Debug draw", "ImGui"};
+static_assert(Containers::arraySize(PhaseNames) == ProfilePhaseCount,
+              "phase names out of sync");
+
+struct Ring {
+    ProfileEvent events[Profiler::RingCapacity];
+    /* Events ever written, incremented by the owning thread after the
+       event is in place */
+    std::atomic<UnsignedLong> written{0};
+    UnsignedShort thread{};
+    const char *name{};
+};
+
+/* Rings of all threads that ever recorded something. They're never
+   removed, so readers don't need to care about threads exiting. */
+struct Registry {
+    std::mutex mutex;
+    Containers::Array<Containers::Pointer<Ring>> rings;
+};
+
+Registry &registry() {
+    static Registry registry;
+    return registry;
+}
+
+Ring &threadRing() {
+    thread_local Ring *ring = [] {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        arrayAppend(r.rings, Containers::Pointer<Ring>{new Ring});
+        r.rings.back()->thread = UnsignedShort(r.rings.size() - 1);
+        return r.rings.back().get();
+    }();
+    return *ring;
+}
+
+std::chrono::steady_clock::time_point epoch() {
+    static const std::chrono::steady_clock::time_point epoch =
+        std::chrono::steady_clock::now();
+    return epoch;
+}
+
+}  // namespace
+
+const char *profilePhaseName(ProfilePhase phase) {
+    return PhaseNames[std::size_t(phase)];
+}
+
+UnsignedLong Profiler::now() {
+    return UnsignedLong(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - epoch())
+                            .count());
+}
+
+void Profiler::record(ProfilePhase phase, UnsignedLong begin,
+                      UnsignedLong end) {
+    Ring &ring = threadRing();
+    const UnsignedLong i = ring.written.load(std::memory_order_relaxed);
+    ring.events[i % RingCapacity] = ProfileEvent{begin, end, phase,
+                                                 ring.thread};
+    ring.written.store(i + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const char *name) {
+    Ring &ring = threadRing();
+    std::lock_guard<std::mutex> lock{registry().mutex};
+    ring.name = name;
+}
+
+void Profiler::read(Containers::Array<UnsignedLong> &positions,
+                    Containers::Array<ProfileEvent> &out) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock{r.mutex};
+    if (positions.size() < r.rings.size())
+        arrayResize(positions, ValueInit, r.rings.size());
+
+    for (std::size_t i = 0; i != r.rings.size(); ++i) {
+        const Ring &ring = *r.rings[i];
+        const UnsignedLong written =
+            ring.written.load(std::memory_order_acquire);
+        const UnsignedLong first = Math::max(
+            positions[i], written > RingCapacity ? written - RingCapacity : 0);
+        const std::size_t offset = out.size();
+        arrayResize(out, NoInit, offset + std::size_t(written - first));
+        for (UnsignedLong j = first; j != written; ++j)
+            out[offset + (j - first)] = ring.events[j % RingCapacity];
+        positions[i] = written;
+
+        /* The owning thread may have overwritten the oldest of them while
+           copying. It may also be in the middle of writing the event after
+           the ones it published, which goes over the slot of the event
+           RingCapacity before it. Any of those copies can be torn, so
+           they're dropped. */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const UnsignedLong after =
+            ring.written.load(std::memory_order_relaxed);
+        if (after + 1 <= RingCapacity)
+            continue;
+        const UnsignedLong intact = after + 1 - RingCapacity;
+        if (intact <= first)
+            continue;
+        const std::size_t overwritten =
+            std::size_t(Math::min(intact, written) - first);
+        for (std::size_t j = offset; j + overwritten < out.size(); ++j)
+            out[j] = out[j + overwritten];
+        arrayResize(out, out.size() - overwritten);
+    }
+}
+
+Long Profiler::writeChromeTrace(const char *filename, UnsignedLong since) {
+    Containers::Array<UnsignedLong> positions;
+    Containers::Array<ProfileEvent> events;
+    read(positions, events);
+
+    std::FILE *file = std::fopen(filename, "w");
+    if (!file)
+        return -1;
+
+    /* Timestamps and durations are in microseconds */
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    const char *separator = "";
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        for (const Containers::Pointer<Ring> &ring : r.rings) {
+            if (!ring->name)
+                continue;
+            std::fprintf(file,
+                         "%s  {\"name\": \"thread_name\", \"ph\": \"M\", "
+                         "\"pid\": 1, \"tid\": %u, "
+                         "\"args\": {\"name\": \"%s\"}}",
+                         separator, UnsignedInt(ring->thread), ring->name);
+            separator = ",\n";
+        }
+    }
+
+    Long count = 0;
+    for (const ProfileEvent &event : events) {
+        if (event.begin < since)
+            continue;
+        std::fprintf(file,
+                     "%s  {\"name\": \"%s\", \"cat\": \"playground\", "
+                     "\"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                     "\"ts\": %.3f, \"dur\": %.3f}",
+                     separator, profilePhaseName(event.phase),
+                     UnsignedInt(event.thread), Double(event.begin) / 1000.0,
+                     Double(event.end - event.begin) / 1000.0);
+        separator = ",\n";
+        ++count;
+    }
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+    return count;
+}
+
+}  // namespace GraphicsPlayground
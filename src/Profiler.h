@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Magnum/Magnum.h>
+
+/* Scoped timer of a phase, for example PLAYGROUND_PROFILE(Step). Without
+   PLAYGROUND_PROFILER it compiles to nothing. */
+#ifdef PLAYGROUND_PROFILER
+#define PLAYGROUND_PROFILE_NAME(line) _playgroundProfileScope##line
+#define PLAYGROUND_PROFILE_SCOPE(phase, line)                               \
+    ::GraphicsPlayground::ProfileScope PLAYGROUND_PROFILE_NAME(line) {      \
+        ::GraphicsPlayground::ProfilePhase::phase                           \
+    }
+#define PLAYGROUND_PROFILE(phase) PLAYGROUND_PROFILE_SCOPE(phase, __LINE__)
+#else
+#define PLAYGROUND_PROFILE(phase) static_cast<void>(0)
+#endif
+
+#ifdef PLAYGROUND_PROFILER
+#include <Corrade/Containers/Array.h>
+
+#include <cstddef>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+enum class ProfilePhase : UnsignedByte {
+    Frame,
+    Housekeeping,
+    Step,
+    Gravity,
+    BallControls,
+    Camera,
+    Instances,
+    Upload,
+    DebugDraw,
+    Gui
+};
+
+enum : std::size_t { ProfilePhaseCount = std::size_t(ProfilePhase::Gui) + 1 };
+
+const char *profilePhaseName(ProfilePhase phase);
+
+/* Times are in nanoseconds since the first use of the profiler */
+struct ProfileEvent {
+    UnsignedLong begin, end;
+    ProfilePhase phase;
+    /* Index of the thread that recorded it, in order of their first event */
+    UnsignedShort thread;
+};
+
+/* Records events into a ring buffer of the calling thread, which is
+   written only by that thread and read without locks by anyone else. The
+   buffer keeps the last RingCapacity events, older ones are overwritten. */
+class Profiler {
+ public:
+    enum : std::size_t { RingCapacity = 1 << 14 };
+
+    static UnsignedLong now();
+
+    static void record(ProfilePhase phase, UnsignedLong begin,
+                       UnsignedLong end);
+
+    /* Name of the calling thread in the trace */
+    static void setThreadName(const char *name);
+
+    /* Appends events recorded after the per-thread positions in given
+       array and advances them. Zero positions, or an empty array, give
+       everything still in the buffers. Events of one thread are ordered by
+       their end. Events the owning thread may have been overwriting while
+       they were copied are dropped, so none of them are torn. */
+    static void read(Containers::Array<UnsignedLong> &positions,
+                     Containers::Array<ProfileEvent> &out);
+
+    /* Writes events that began at given time or later as Chrome
+       trace-event JSON, viewable in chrome://tracing or Perfetto. Returns
+       the number of events written, or -1 if the file can't be opened. */
+    static Long writeChromeTrace(const char *filename, UnsignedLong since);
+};
+
+/* Records an event from construction to destruction */
+class ProfileScope {
+ public:
+    explicit ProfileScope(ProfilePhase phase)
+        : _phase{phase}, _begin{Profiler::now()} {}
+
+    ~ProfileScope() { Profiler::record(_phase, _begin, Profiler::now()); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+ private:
+    ProfilePhase _phase;
+    UnsignedLong _begin;
+};
+
+}  // namespace GraphicsPlayground
+#endif
@@ -0,0 +1,82 @@
+#include "RigidBodyPool.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+
+namespace GraphicsPlayground {
+
+RigidBodyPool::RigidBodyPool(Object3D &parent, Float mass,
+                             btCollisionShape &bShape,
+                             btDynamicsWorld &bWorld)
+    : _parent(parent), _mass{mass}, _bShape(bShape), _bWorld(bWorld) {}
+
+RigidBodyPool::~RigidBodyPool() {
+    for (std::size_t i = _size; i != 0; --i)
+        _slabs[(i - 1) / SlabSize][(i - 1) % SlabSize].~RigidBody();
+    for (RigidBody *slab : _slabs)
+        btAlignedFree(slab);
+}
+
+void RigidBodyPool::reserve(std::size_t count) {
+    if (count <= _size)
+        return;
+
+    arrayReserve(_parked, _parked.size() + count - _size);
+    while (_size != count) {
+        RigidBody &body = construct();
+        body.park();
+        arrayAppend(_parked, &body);
+    }
+}
+
+RigidBody &RigidBodyPool::acquire() {
+    if (_parked.isEmpty())
+        return construct();
+
+    RigidBody &body = *_parked.back();
+    arrayResize(_parked, _parked.size() - 1);
+    body.unpark();
+    return body;
+}
+
+void RigidBodyPool::release(RigidBody &body) {
+    CORRADE_ASSERT(owns(body),
+                   "RigidBodyPool::release(): body not from this pool", );
+    body.park();
+    arrayAppend(_parked, &body);
+}
+
+bool RigidBodyPool::owns(const RigidBody &body) const {
+    for (std::size_t i = 0; i != _slabs.size(); ++i) {
+        const std::size_t size =
+            i + 1 == _slabs.size() ? _size - i * SlabSize : SlabSize;
+        if (&body >= _slabs[i] && &body < _slabs[i] + size)
+            return true;
+    }
+    return false;
+}
+
+std::size_t RigidBodyPool::size() const {
+    return _size;
+}
+
+std::size_t RigidBodyPool::parkedCount() const {
+    return _parked.size();
+}
+
+std::size_t RigidBodyPool::slabCount() const {
+    return _slabs.size();
+}
+
+RigidBody &RigidBodyPool::construct() {
+    if (_size == _slabs.size() * SlabSize)
+        arrayAppend(_slabs, static_cast<RigidBody *>(btAlignedAlloc(
+                                sizeof(RigidBody) * SlabSize, 16)));
+
+    RigidBody *body = new (_slabs.back() + _size % SlabSize)
+        RigidBody{&_parent, _mass, &_bShape, _bWorld};
+    ++_size;
+    return *body;
+}
+
+}  // namespace GraphicsPlayground
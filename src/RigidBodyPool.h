@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Rigidbody.h"
+
+#include <Corrade/Containers/Array.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Dynamic bodies of one shape and mass, constructed in slabs of SlabSize
+   and recycled instead of deleted. A released body is parked in the world
+   and handed out again by the next acquire(), so once the pool grew to the
+   peak body count, spawning and removing bodies doesn't allocate anything.
+
+   The bodies are children of given parent, which has to outlive the pool,
+   same as the world and the shape. */
+class RigidBodyPool {
+ public:
+    enum : std::size_t { SlabSize = 256 };
+
+    RigidBodyPool(Object3D &parent, Float mass, btCollisionShape &bShape,
+                  btDynamicsWorld &bWorld);
+
+    /* Destroys all bodies, parked or not */
+    ~RigidBodyPool();
+
+    RigidBodyPool(const RigidBodyPool &) = delete;
+    RigidBodyPool &operator=(const RigidBodyPool &) = delete;
+
+    /* Constructs parked bodies upfront until there's given total count */
+    void reserve(std::size_t count);
+
+    /* Returns a body at rest, unparked if there's one parked and
+       constructed otherwise. The pose it was parked with is kept, it has
+       to be set and synced by the caller. */
+    RigidBody &acquire();
+
+    /* Parks a body acquired from this pool, removing its instance if it
+       still has one */
+    void release(RigidBody &body);
+
+    /* Whether given body was constructed by this pool */
+    bool owns(const RigidBody &body) const;
+
+    /* Bodies constructed so far, parked ones included */
+    std::size_t size() const;
+    std::size_t parkedCount() const;
+    std::size_t slabCount() const;
+
+ private:
+    RigidBody &construct();
+
+    Object3D &_parent;
+    Float _mass;
+    btCollisionShape &_bShape;
+    btDynamicsWorld &_bWorld;
+
+    /* Storage for SlabSize bodies each, aligned for Bullet. The first
+       _size bodies are constructed. */
+    Containers::Array<RigidBody *> _slabs;
+    std::size_t _size{};
+    Containers::Array<RigidBody *> _parked;
+};
+
+}  // namespace GraphicsPlayground
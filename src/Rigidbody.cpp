@@ -1,39 +1,170 @@
 #include "Rigidbody.h"
 
+#include "InstanceStore.h"
+
+#include <Corrade/Utility/Assert.h>
 #include <Magnum/BulletIntegration/Integration.h>
-#include <Magnum/BulletIntegration/MotionState.h>
+#include <Magnum/Math/Functions.h>
 
 namespace GraphicsPlayground {
 
-RigidBody::RigidBody(Object3D *parent, Float mass, btCollisionShape *bShape,
-                     btDynamicsWorld &bWorld)
-    : Object3D{parent}, _bWorld(bWorld) {
-    /* Calculate inertia so the object reacts as it should with
-       rotation and everything */
+/* The bodies are direct children of the scene, so their transformation is
+   also their absolute transformation. The instance is updated separately
+   in interpolate(). */
+void RigidBody::MotionState::getWorldTransform(btTransform &transform) const {
+    transform = btTransform{_body.transformationMatrix()};
+}
+
+/* The transform passed here is extrapolated by Bullet to the time left over
+   from its own fixed substeps, the exact state at the end of the step is
+   taken from the body instead */
+void RigidBody::MotionState::setWorldTransform(const btTransform &) {
+    _body.setTransformation(Matrix4{_body._bRigidBody.getWorldTransform()});
+}
+
+/* Calculate inertia so the object reacts as it should with rotation and
+   everything */
+btVector3 RigidBody::localInertia(Float mass, btCollisionShape *bShape) {
     btVector3 bInertia(0.0f, 0.0f, 0.0f);
     if (!Math::TypeTraits<Float>::equals(mass, 0.0f))
         bShape->calculateLocalInertia(mass, bInertia);
+    return bInertia;
+}
 
-    /* Bullet rigid body setup */
-    auto *motionState = new BulletIntegration::MotionState{*this};
-    _bRigidBody.emplace(btRigidBody::btRigidBodyConstructionInfo{
-        mass, &motionState->btMotionState(), bShape, bInertia});
-    _bRigidBody->forceActivationState(DISABLE_DEACTIVATION);
-    _bRigidBody->setFlags(BT_DISABLE_WORLD_GRAVITY |
-                          BT_ENABLE_GYROSCOPIC_FORCE_IMPLICIT_BODY);
-    bWorld.addRigidBody(_bRigidBody.get());
+RigidBody::RigidBody(Object3D *parent, Float mass, btCollisionShape *bShape,
+                     btDynamicsWorld &bWorld)
+    : Object3D{parent},
+      _bWorld(bWorld),
+      _motionState{*this},
+      _bRigidBody{btRigidBody::btRigidBodyConstructionInfo{
+          mass, &_motionState, bShape, localInertia(mass, bShape)}} {
+    /* Bodies fall asleep with their island once it rests for long enough
+       under Bullet's default thresholds */
+    _bRigidBody.setFlags(BT_DISABLE_WORLD_GRAVITY |
+                         BT_ENABLE_GYROSCOPIC_FORCE_IMPLICIT_BODY);
+    _bRigidBody.setUserPointer(this);
+    _previousTransform = _bRigidBody.getWorldTransform();
+    bWorld.addRigidBody(&_bRigidBody);
 }
 
 RigidBody::~RigidBody() {
-    _bWorld.removeRigidBody(_bRigidBody.get());
+    _bWorld.removeRigidBody(&_bRigidBody);
+    if (_instances)
+        _instances->remove(_instance);
 }
 
 btRigidBody &RigidBody::rigidBody() {
-    return *_bRigidBody;
+    return _bRigidBody;
 }
 
 void RigidBody::syncPose() {
-    _bRigidBody->setWorldTransform(btTransform(transformationMatrix()));
+    /* A teleport, not interpolated */
+    const btTransform transform{transformationMatrix()};
+    _bRigidBody.setWorldTransform(transform);
+    _bRigidBody.activate(true);
+    _previousTransform = transform;
+    interpolate(1.0f);
+}
+
+void RigidBody::attachInstance(InstanceStore &instances, const Color3 &color,
+                               Float scale) {
+    CORRADE_ASSERT(!_instances,
+                   "RigidBody::attachInstance(): already attached", );
+    _instances = &instances;
+    _instance = instances.add(color, scale);
+    interpolate(1.0f);
+}
+
+InstanceStore *RigidBody::instances() const {
+    return _instances;
+}
+
+UnsignedInt RigidBody::instance() const {
+    return _instance;
+}
+
+void RigidBody::releaseInstance() {
+    _instances = nullptr;
+}
+
+void RigidBody::beginTick() {
+    _previousTransform = _bRigidBody.getWorldTransform();
+    _settled = false;
+}
+
+Vector3 RigidBody::interpolate(Float factor) {
+    const btTransform &transform = _bRigidBody.getWorldTransform();
+    const Vector3 position{transform.getOrigin()};
+    if (transform == _previousTransform) {
+        if (_instances)
+            _instances->setTransformation(
+                _instance, position, Quaternion{transform.getRotation()});
+        _settled = true;
+        return position;
+    }
+
+    const Vector3 interpolated = Math::lerp(
+        Vector3{_previousTransform.getOrigin()}, position, factor);
+    if (_instances)
+        _instances->setTransformation(
+            _instance, interpolated,
+            Math::lerpShortestPath(Quaternion{_previousTransform.getRotation()},
+                                   Quaternion{transform.getRotation()},
+                                   factor));
+    return interpolated;
+}
+
+bool RigidBody::hasSettled() const {
+    return _settled;
+}
+
+const btTransform &RigidBody::previousTransform() const {
+    return _previousTransform;
+}
+
+bool RigidBody::isParked() const {
+    return _parked;
+}
+
+void RigidBody::park() {
+    /* Parking again would save the zeroed filter below as the one to
+       restore */
+    if (_parked)
+        return;
+    if (_instances) {
+        _instances->remove(_instance);
+        _instances = nullptr;
+    }
+
+    /* A zero filter doesn't let the broadphase create any new pairs, the
+       existing ones are removed from the cache right away, which also
+       tells the ghost pair callback about them */
+    btBroadphaseProxy *proxy = _bRigidBody.getBroadphaseHandle();
+    _collisionFilterGroup = proxy->m_collisionFilterGroup;
+    _collisionFilterMask = proxy->m_collisionFilterMask;
+    proxy->m_collisionFilterGroup = 0;
+    proxy->m_collisionFilterMask = 0;
+    _bWorld.getBroadphase()
+        ->getOverlappingPairCache()
+        ->removeOverlappingPairsContainingProxy(proxy,
+                                                _bWorld.getDispatcher());
+
+    /* Not integrated, and without AABB updates either */
+    _bRigidBody.forceActivationState(DISABLE_SIMULATION);
+    _bRigidBody.setLinearVelocity(btVector3{0.0f, 0.0f, 0.0f});
+    _bRigidBody.setAngularVelocity(btVector3{0.0f, 0.0f, 0.0f});
+    _bRigidBody.clearForces();
+    _parked = true;
+}
+
+void RigidBody::unpark() {
+    CORRADE_ASSERT(_parked, "RigidBody::unpark(): not parked", );
+    btBroadphaseProxy *proxy = _bRigidBody.getBroadphaseHandle();
+    proxy->m_collisionFilterGroup = _collisionFilterGroup;
+    proxy->m_collisionFilterMask = _collisionFilterMask;
+    _bRigidBody.forceActivationState(ACTIVE_TAG);
+    _bRigidBody.setDeactivationTime(0.0f);
+    _parked = false;
 }
 
-}  // namespace GraphicsPlayground
\ No newline at end of file
+}  // namespace GraphicsPlayground
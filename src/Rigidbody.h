@@ -1,6 +1,7 @@
 #pragma once
 
-#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Quaternion.h>
 #include <Magnum/SceneGraph/MatrixTransformation3D.h>
 #include <btBulletDynamicsCommon.h>
 
@@ -8,10 +9,17 @@ namespace GraphicsPlayground {
 
 using namespace Magnum;
 
+class InstanceStore;
+
 typedef SceneGraph::Object<SceneGraph::MatrixTransformation3D> Object3D;
 
+/* The motion state and the Bullet body are stored inline, so a body is a
+   single allocation, or none when it's constructed in a RigidBodyPool
+   slab */
 class RigidBody : public Object3D {
  public:
+    BT_DECLARE_ALIGNED_ALLOCATOR();
+
     RigidBody(Object3D *parent, Float mass, btCollisionShape *bShape,
               btDynamicsWorld &bWorld);
 
@@ -22,9 +30,79 @@ class RigidBody : public Object3D {
     /* needed after changing the pose from Magnum side */
     void syncPose();
 
+    /* Adds an instance to given store, which then gets the world
+       transformation of the body from interpolate(). The instance is
+       removed on destruction, so the store has to outlive the body. */
+    void attachInstance(InstanceStore &instances, const Color3 &color,
+                        Float scale);
+
+    /* Store the instance is in, null if there's none */
+    InstanceStore *instances() const;
+    UnsignedInt instance() const;
+
+    /* Forgets the instance without removing it from the store, whoever
+       took it over has to remove it */
+    void releaseInstance();
+
+    /* Remembers the current state as the one to interpolate from, done by
+       Simulation before every tick */
+    void beginTick();
+
+    /* Updates the instance with the state given fraction of the way from
+       the one at beginTick() to the current one, returns the interpolated
+       position. Bodies that didn't move in the last tick get exactly their
+       current state. */
+    Vector3 interpolate(Float factor);
+
+    /* Whether the last interpolate() since beginTick() put the instance at
+       the current state. A sleeping body that has settled doesn't need
+       either called until it wakes up. */
+    bool hasSettled() const;
+
+    /* State at the last beginTick() */
+    const btTransform &previousTransform() const;
+
+    /* Whether the body is parked. A parked body stays in the world, so
+       reusing it doesn't go through the broadphase proxy allocation of
+       addRigidBody(), but it's neither simulated nor collides with
+       anything. */
+    bool isParked() const;
+
+    /* Removes the instance, if any, stops the body and parks it. Used by
+       RigidBodyPool. Does nothing if the body is parked already. */
+    void park();
+
+    /* Makes a parked body collide and simulated again, at rest. The pose
+       has to be set and synced after. */
+    void unpark();
+
  private:
+    /* Updates the object with the transformation calculated by Bullet */
+    class MotionState : public btMotionState {
+     public:
+        explicit MotionState(RigidBody &body) : _body(body) {}
+
+        void getWorldTransform(btTransform &transform) const override;
+        void setWorldTransform(const btTransform &) override;
+
+     private:
+        RigidBody &_body;
+    };
+
+    static btVector3 localInertia(Float mass, btCollisionShape *bShape);
+
     btDynamicsWorld &_bWorld;
-    Containers::Pointer<btRigidBody> _bRigidBody;
+    MotionState _motionState;
+    btRigidBody _bRigidBody;
+    btTransform _previousTransform;
+    bool _settled{};
+
+    /* Broadphase filter to restore on unpark() */
+    Int _collisionFilterGroup{}, _collisionFilterMask{};
+    bool _parked{};
+
+    InstanceStore *_instances{};
+    UnsignedInt _instance{};
 };
 
 }  // namespace GraphicsPlayground
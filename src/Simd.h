@@ -0,0 +1,276 @@
+#pragma once
+
+#include <Magnum/Magnum.h>
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(CORRADE_TARGET_AVX)
+#include <immintrin.h>
+#elif defined(CORRADE_TARGET_SSE2)
+#include <emmintrin.h>
+#elif defined(CORRADE_TARGET_SIMD128)
+#include <wasm_simd128.h>
+#endif
+
+/* Thin wrapper around the widest float vector type the target is compiled
+   for, so batch kernels can be written once for AVX, SSE2, WebAssembly
+   SIMD128 and a plain scalar fallback. A Mask is the result of a comparison,
+   with all bits of a lane set if the comparison was true for it. */
+
+namespace GraphicsPlayground {
+namespace Simd {
+
+using namespace Magnum;
+
+#if defined(CORRADE_TARGET_AVX)
+constexpr const std::size_t Width = 8;
+
+typedef __m256 Pack;
+typedef __m256 Mask;
+
+inline Pack load(const Float *data) {
+    return _mm256_loadu_ps(data);
+}
+inline void store(Float *data, Pack a) {
+    _mm256_storeu_ps(data, a);
+}
+inline Pack splat(Float a) {
+    return _mm256_set1_ps(a);
+}
+inline Pack add(Pack a, Pack b) {
+    return _mm256_add_ps(a, b);
+}
+inline Pack sub(Pack a, Pack b) {
+    return _mm256_sub_ps(a, b);
+}
+inline Pack mul(Pack a, Pack b) {
+    return _mm256_mul_ps(a, b);
+}
+inline Pack div(Pack a, Pack b) {
+    return _mm256_div_ps(a, b);
+}
+inline Pack min(Pack a, Pack b) {
+    return _mm256_min_ps(a, b);
+}
+inline Pack max(Pack a, Pack b) {
+    return _mm256_max_ps(a, b);
+}
+inline Pack sqrt(Pack a) {
+    return _mm256_sqrt_ps(a);
+}
+inline Pack abs(Pack a) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+}
+inline Mask greater(Pack a, Pack b) {
+    return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+}
+inline Mask less(Pack a, Pack b) {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+inline Mask both(Mask a, Mask b) {
+    return _mm256_and_ps(a, b);
+}
+inline Mask either(Mask a, Mask b) {
+    return _mm256_or_ps(a, b);
+}
+/* a && !b */
+inline Mask andNot(Mask a, Mask b) {
+    return _mm256_andnot_ps(b, a);
+}
+/* mask ? a : b, per lane */
+inline Pack select(Mask mask, Pack a, Pack b) {
+    return _mm256_blendv_ps(b, a, mask);
+}
+/* One bit per lane, lowest bit being the first lane */
+inline Int bits(Mask mask) {
+    return _mm256_movemask_ps(mask);
+}
+#elif defined(CORRADE_TARGET_SSE2)
+constexpr const std::size_t Width = 4;
+
+typedef __m128 Pack;
+typedef __m128 Mask;
+
+inline Pack load(const Float *data) {
+    return _mm_loadu_ps(data);
+}
+inline void store(Float *data, Pack a) {
+    _mm_storeu_ps(data, a);
+}
+inline Pack splat(Float a) {
+    return _mm_set1_ps(a);
+}
+inline Pack add(Pack a, Pack b) {
+    return _mm_add_ps(a, b);
+}
+inline Pack sub(Pack a, Pack b) {
+    return _mm_sub_ps(a, b);
+}
+inline Pack mul(Pack a, Pack b) {
+    return _mm_mul_ps(a, b);
+}
+inline Pack div(Pack a, Pack b) {
+    return _mm_div_ps(a, b);
+}
+inline Pack min(Pack a, Pack b) {
+    return _mm_min_ps(a, b);
+}
+inline Pack max(Pack a, Pack b) {
+    return _mm_max_ps(a, b);
+}
+inline Pack sqrt(Pack a) {
+    return _mm_sqrt_ps(a);
+}
+inline Pack abs(Pack a) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+inline Mask greater(Pack a, Pack b) {
+    return _mm_cmpgt_ps(a, b);
+}
+inline Mask less(Pack a, Pack b) {
+    return _mm_cmplt_ps(a, b);
+}
+inline Mask both(Mask a, Mask b) {
+    return _mm_and_ps(a, b);
+}
+inline Mask either(Mask a, Mask b) {
+    return _mm_or_ps(a, b);
+}
+inline Mask andNot(Mask a, Mask b) {
+    return _mm_andnot_ps(b, a);
+}
+/* SSE2 has no blend instruction */
+inline Pack select(Mask mask, Pack a, Pack b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+inline Int bits(Mask mask) {
+    return _mm_movemask_ps(mask);
+}
+#elif defined(CORRADE_TARGET_SIMD128)
+constexpr const std::size_t Width = 4;
+
+typedef v128_t Pack;
+typedef v128_t Mask;
+
+inline Pack load(const Float *data) {
+    return wasm_v128_load(data);
+}
+inline void store(Float *data, Pack a) {
+    wasm_v128_store(data, a);
+}
+inline Pack splat(Float a) {
+    return wasm_f32x4_splat(a);
+}
+inline Pack add(Pack a, Pack b) {
+    return wasm_f32x4_add(a, b);
+}
+inline Pack sub(Pack a, Pack b) {
+    return wasm_f32x4_sub(a, b);
+}
+inline Pack mul(Pack a, Pack b) {
+    return wasm_f32x4_mul(a, b);
+}
+inline Pack div(Pack a, Pack b) {
+    return wasm_f32x4_div(a, b);
+}
+/* The pseudo-minimum and maximum map to a single instruction on x86, unlike
+   wasm_f32x4_min() and wasm_f32x4_max() which have to handle NaNs and signed
+   zeros */
+inline Pack min(Pack a, Pack b) {
+    return wasm_f32x4_pmin(a, b);
+}
+inline Pack max(Pack a, Pack b) {
+    return wasm_f32x4_pmax(a, b);
+}
+inline Pack sqrt(Pack a) {
+    return wasm_f32x4_sqrt(a);
+}
+inline Pack abs(Pack a) {
+    return wasm_f32x4_abs(a);
+}
+inline Mask greater(Pack a, Pack b) {
+    return wasm_f32x4_gt(a, b);
+}
+inline Mask less(Pack a, Pack b) {
+    return wasm_f32x4_lt(a, b);
+}
+inline Mask both(Mask a, Mask b) {
+    return wasm_v128_and(a, b);
+}
+inline Mask either(Mask a, Mask b) {
+    return wasm_v128_or(a, b);
+}
+inline Mask andNot(Mask a, Mask b) {
+    return wasm_v128_andnot(a, b);
+}
+inline Pack select(Mask mask, Pack a, Pack b) {
+    return wasm_v128_bitselect(a, b, mask);
+}
+inline Int bits(Mask mask) {
+    return wasm_i32x4_bitmask(mask);
+}
+#else
+constexpr const std::size_t Width = 1;
+
+typedef Float Pack;
+typedef bool Mask;
+
+inline Pack load(const Float *data) {
+    return *data;
+}
+inline void store(Float *data, Pack a) {
+    *data = a;
+}
+inline Pack splat(Float a) {
+    return a;
+}
+inline Pack add(Pack a, Pack b) {
+    return a + b;
+}
+inline Pack sub(Pack a, Pack b) {
+    return a - b;
+}
+inline Pack mul(Pack a, Pack b) {
+    return a * b;
+}
+inline Pack div(Pack a, Pack b) {
+    return a / b;
+}
+inline Pack min(Pack a, Pack b) {
+    return b < a ? b : a;
+}
+inline Pack max(Pack a, Pack b) {
+    return a < b ? b : a;
+}
+inline Pack sqrt(Pack a) {
+    return std::sqrt(a);
+}
+inline Pack abs(Pack a) {
+    return std::abs(a);
+}
+inline Mask greater(Pack a, Pack b) {
+    return a > b;
+}
+inline Mask less(Pack a, Pack b) {
+    return a < b;
+}
+inline Mask both(Mask a, Mask b) {
+    return a && b;
+}
+inline Mask either(Mask a, Mask b) {
+    return a || b;
+}
+inline Mask andNot(Mask a, Mask b) {
+    return a && !b;
+}
+inline Pack select(Mask mask, Pack a, Pack b) {
+    return mask ? a : b;
+}
+inline Int bits(Mask mask) {
+    return mask ? 1 : 0;
+}
+#endif
+
+}  // namespace Simd
+}  // namespace GraphicsPlayground
@@ -0,0 +1,512 @@
+#include "Simulation.h"
+
+#include "GravityBox.h"
+#include "Profiler.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/BulletIntegration/Integration.h>
+#include <Magnum/Math/Functions.h>
+#include <LinearMath/btQuickprof.h>
+#ifdef PLAYGROUND_BULLET_MT
+#include <LinearMath/btThreads.h>
+#endif
+
+#include <cstring>
+#include <utility>
+
+namespace GraphicsPlayground {
+
+namespace {
+
+#ifdef PLAYGROUND_BULLET_MT
+/* Created on first use and kept for the lifetime of the process, as Bullet
+   has just a single global scheduler */
+btITaskScheduler &taskScheduler() {
+    static btITaskScheduler *scheduler = [] {
+        /* Null if Bullet itself wasn't built with threads */
+        btITaskScheduler *scheduler = btCreateDefaultTaskScheduler();
+        if (!scheduler)
+            scheduler = btGetSequentialTaskScheduler();
+        btSetTaskScheduler(scheduler);
+        return scheduler;
+    }();
+    return *scheduler;
+}
+#endif
+
+#ifndef BT_NO_PROFILE
+/* Appends the scopes below the current one depth-first. The iterator only
+   goes to the n-th child, so the siblings are walked again for each. */
+void writeProfile(CProfileIterator &iterator, Int depth,
+                  Containers::Array<PhysicsStatistics::ProfileScope> &out) {
+    Int count = 0;
+    for (iterator.First(); !iterator.Is_Done(); iterator.Next())
+        ++count;
+
+    for (Int i = 0; i != count; ++i) {
+        iterator.First();
+        for (Int j = 0; j != i; ++j)
+            iterator.Next();
+        arrayAppend(out, PhysicsStatistics::ProfileScope{
+                             iterator.Get_Current_Name(), depth,
+                             iterator.Get_Current_Total_Calls(),
+                             iterator.Get_Current_Total_Time()});
+        iterator.Enter_Child(i);
+        writeProfile(iterator, depth + 1, out);
+        iterator.Enter_Parent();
+    }
+}
+#endif
+
+/* Sleeping and parked bodies don't move, so once the instance got their
+   final state there's nothing to remember before a tick or to interpolate
+   after it. A body that fell asleep in the last tick still needs one more
+   update. */
+bool needsUpdate(const btRigidBody &bRigidBody) {
+    return bRigidBody.isActive() ||
+           !static_cast<const RigidBody *>(bRigidBody.getUserPointer())
+                ->hasSettled();
+}
+
+}  // namespace
+
+Simulation::Simulation() {
+    _gravityFields.emplace<GravityBox>(19.62f, Vector3{4.0f, 4.0f, 4.0f}, 0.0f,
+                                       0.0f, 8.0f, 12.0f);
+
+    _bWorld.setInternalTickCallback(preTickCallback, this, true);
+
+    /* Create the ground */
+    _ground = new RigidBody{&_scene, 0.0f, &_bGroundShape, _bWorld};
+
+    _ball = new MovingSphere{&_scene, &_bSphereShape, _bWorld};
+    _ball->translate({0.0f, 4.0f, 0.0f});
+    _ball->rigidBody().setFriction(1.0f);
+    _ball->rigidBody().setRollingFriction(0.1f);
+    _ball->rigidBody().setSpinningFriction(0.1f);
+
+    /* Has to be done explicitly after the translate() above, as Magnum ->
+       Bullet updates are implicitly done only for kinematic bodies */
+    _ball->syncPose();
+    _interpolatedBallPosition = ballPosition();
+}
+
+Scene3D &Simulation::scene() {
+    return _scene;
+}
+
+btDiscreteDynamicsWorld &Simulation::world() {
+    return _bWorld;
+}
+
+Int Simulation::maxThreadCount() {
+#ifdef PLAYGROUND_BULLET_MT
+    return taskScheduler().getMaxNumThreads();
+#else
+    return 1;
+#endif
+}
+
+Int Simulation::threadCount() {
+#ifdef PLAYGROUND_BULLET_MT
+    return taskScheduler().getNumThreads();
+#else
+    return 1;
+#endif
+}
+
+void Simulation::setThreadCount(Int count) {
+#ifdef PLAYGROUND_BULLET_MT
+    taskScheduler().setNumThreads(Math::clamp(count, 1, maxThreadCount()));
+#else
+    static_cast<void>(count);
+#endif
+}
+
+RigidBody &Simulation::ground() {
+    return *_ground;
+}
+
+Vector3 Simulation::groundHalfExtents() const {
+    return Vector3{_bGroundShape.getHalfExtentsWithMargin()};
+}
+
+MovingSphere &Simulation::ball() {
+    return *_ball;
+}
+
+GravityFieldRegistry &Simulation::gravityFields() {
+    return _gravityFields;
+}
+
+const BakedGravityField &Simulation::bakeGravity(const Range3D &range,
+                                                const Vector3i &size) {
+    setBakedGravity(BakedGravityField{_gravityFields, range, size});
+    return *_bakedGravity;
+}
+
+void Simulation::setBakedGravity(BakedGravityField &&field) {
+    _bakedGravity = std::move(field);
+    _gravitySystem.setField(*_bakedGravity);
+}
+
+void Simulation::clearBakedGravity() {
+    _gravitySystem.setField(_gravityFields);
+    _bakedGravity = Containers::NullOpt;
+}
+
+const BakedGravityField *Simulation::bakedGravity() const {
+    return _bakedGravity ? &*_bakedGravity : nullptr;
+}
+
+Vector3 Simulation::ballPosition() const {
+    return Vector3{_ball->rigidBody().getCenterOfMassPosition()};
+}
+
+Vector3 Simulation::ballGravity() const {
+    return _ballGravity;
+}
+
+Vector3 Simulation::ballUpAxis() const {
+    return _ballUpAxis;
+}
+
+RigidBody *Simulation::addBox(const Vector3 &position) {
+    RigidBody &o = _boxes.acquire();
+    o.setTransformation(Matrix4::translation(position));
+    o.syncPose();
+    return &o;
+}
+
+RigidBodyPool &Simulation::boxes() {
+    return _boxes;
+}
+
+const Range3D &Simulation::killBounds() const {
+    return _killVolume.bounds();
+}
+
+void Simulation::setKillBounds(const Range3D &bounds) {
+    _killVolume.setBounds(bounds);
+}
+
+void Simulation::removeDistantObjects() {
+    /* Collected first, as removing them changes the overlapping pairs */
+    arrayResize(_leavingBodies, 0);
+    _killVolume.collect(_leavingBodies);
+    for (RigidBody *body : _leavingBodies) {
+        if (_instanceRemovalDeferred && body->instances()) {
+            arrayAppend(_removedInstances,
+                        RemovedInstance{body->instances(), body->instance(),
+                                        _tickCount});
+            body->releaseInstance();
+        }
+        if (_boxes.owns(*body))
+            _boxes.release(*body);
+        else
+            delete body;
+    }
+}
+
+bool Simulation::isInstanceRemovalDeferred() const {
+    return _instanceRemovalDeferred;
+}
+
+void Simulation::setInstanceRemovalDeferred(bool deferred) {
+    _instanceRemovalDeferred = deferred;
+}
+
+Containers::ArrayView<const RemovedInstance>
+Simulation::removedInstances() const {
+    return _removedInstances;
+}
+
+void Simulation::clearRemovedInstances() {
+    arrayResize(_removedInstances, 0);
+}
+
+void Simulation::step(Float timeStep, Int maxSubSteps) {
+    /* Baked gravity doesn't change until baked again, which wakes
+       everything */
+    if (const Containers::Optional<Range3D> changed =
+            _gravityFields.takeChangedBounds())
+        if (!_bakedGravity)
+            _gravitySystem.wake(*changed);
+
+#ifndef BT_NO_PROFILE
+    /* Bullet's profiler accumulates until reset, keep just this step */
+    CProfileManager::Reset();
+#endif
+    {
+        PLAYGROUND_PROFILE(Step);
+        _gravitySystem.beginStep();
+        _requestedSubSteps = _bWorld.stepSimulation(timeStep, maxSubSteps);
+    }
+    /* Without substeps the time step is done as a single one. The count
+       returned by Bullet is before clamping. */
+    _maxSubSteps = maxSubSteps ? maxSubSteps : 1;
+    _substeps = Math::min(_requestedSubSteps, _maxSubSteps);
+
+    /* Get gravity and up-pointing vector at the final position of the sphere,
+       used for its controls and the camera */
+    _ballGravity =
+        _gravitySystem.field().getGravity(ballPosition(), &_ballUpAxis);
+}
+
+Float Simulation::tickRate() const {
+    return 1.0f / _tickDuration;
+}
+
+void Simulation::setTickRate(Float ticksPerSecond) {
+    CORRADE_ASSERT(ticksPerSecond > 0.0f,
+                   "Simulation::setTickRate(): expected a positive rate", );
+    /* Keep the rendered state at the same point in time */
+    const Float tickDuration = 1.0f / ticksPerSecond;
+    _accumulator = Math::min(_accumulator, tickDuration);
+    _tickDuration = tickDuration;
+}
+
+Float Simulation::maxFrameDuration() const {
+    return _maxFrameDuration;
+}
+
+void Simulation::setMaxFrameDuration(Float seconds) {
+    _maxFrameDuration = seconds;
+}
+
+void Simulation::setBallInput(const Matrix4 &inputSpace,
+                              const Vector3 &input) {
+    _ballInputSpace = inputSpace;
+    _ballInput = input;
+}
+
+void Simulation::jumpBall() {
+    _ballJump = true;
+}
+
+Int Simulation::runTicks(Float frameDuration) {
+    if (frameDuration > _maxFrameDuration)
+        ++_clampedFrames;
+    _accumulator += Math::min(frameDuration, _maxFrameDuration);
+
+    Int ticks = 0;
+    while (_accumulator >= _tickDuration) {
+        tick();
+        _accumulator -= _tickDuration;
+        ++ticks;
+    }
+    return ticks;
+}
+
+Int Simulation::advance(Float frameDuration) {
+    const Int ticks = runTicks(frameDuration);
+    interpolate(_accumulator / _tickDuration);
+    return ticks;
+}
+
+Int Simulation::runFrame(const InputFrame &frame) {
+    /* Housekeeping: remove any objects which left the kill bounds in the
+       last step */
+    {
+        PLAYGROUND_PROFILE(Housekeeping);
+        removeDistantObjects();
+    }
+
+    if (tickRate() != frame.tickRate)
+        setTickRate(frame.tickRate);
+    setBallInput(Matrix4{{frame.inputRight, 0.0f},
+                         {Math::cross(frame.inputBackward, frame.inputRight),
+                          0.0f},
+                         {frame.inputBackward, 0.0f},
+                         {0.0f, 0.0f, 0.0f, 1.0f}},
+                 Vector3{Float(frame.ballInputX), 0.0f,
+                         Float(frame.ballInputZ)});
+    if (frame.jump)
+        jumpBall();
+    return advance(frame.duration);
+}
+
+UnsignedLong Simulation::stateChecksum() const {
+    /* FNV-1a over the bits of the basis and origin of each body */
+    UnsignedLong hash = 14695981039346656037ull;
+    auto add = [&hash](btScalar value) {
+        const Float f = Float(value);
+        UnsignedInt bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        for (Int i = 0; i != 4; ++i) {
+            hash ^= (bits >> (8 * i)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+
+    const btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    for (Int i = 0; i != bodies.size(); ++i) {
+        const btTransform &transform = bodies[i]->getWorldTransform();
+        for (Int row = 0; row != 3; ++row) {
+            const btVector3 &basis = transform.getBasis()[row];
+            add(basis.x());
+            add(basis.y());
+            add(basis.z());
+        }
+        add(transform.getOrigin().x());
+        add(transform.getOrigin().y());
+        add(transform.getOrigin().z());
+    }
+    return hash;
+}
+
+std::size_t Simulation::sleepingBodyCount() const {
+    const btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    std::size_t count = 0;
+    for (Int i = 0; i != bodies.size(); ++i)
+        if (bodies[i]->getActivationState() == ISLAND_SLEEPING)
+            ++count;
+    return count;
+}
+
+void Simulation::writeStatistics(PhysicsStatistics &out) {
+    arrayResize(out.profile, 0);
+#ifndef BT_NO_PROFILE
+    /* Null for threads above the count Bullet has profiles for */
+    if (CProfileIterator *iterator = CProfileManager::Get_Iterator()) {
+        writeProfile(*iterator, 0, out.profile);
+        CProfileManager::Release_Iterator(iterator);
+    }
+#endif
+
+    out.overlappingPairs =
+        _bBroadphase.getOverlappingPairCache()->getNumOverlappingPairs();
+    out.manifolds = _bDispatcher.getNumManifolds();
+    out.contactPoints = 0;
+    for (Int i = 0; i != out.manifolds; ++i)
+        out.contactPoints +=
+            _bDispatcher.getManifoldByIndexInternal(i)->getNumContacts();
+
+    /* Island tags are indices of collision objects, assigned to all
+       dynamic bodies in every step. Bodies removed since may have left the
+       indices out of range. */
+    arrayResize(_islandSizes, 0);
+    arrayResize(_islandSizes, ValueInit,
+                std::size_t(_bWorld.getNumCollisionObjects()));
+    out.islands = out.largestIsland = 0;
+    out.activeBodies = out.sleepingBodies = out.disabledBodies = 0;
+    const btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    for (Int i = 0; i != bodies.size(); ++i) {
+        const Int state = bodies[i]->getActivationState();
+        if (state == DISABLE_SIMULATION) {
+            ++out.disabledBodies;
+            continue;
+        }
+        if (state == ISLAND_SLEEPING)
+            ++out.sleepingBodies;
+        else
+            ++out.activeBodies;
+
+        const Int tag = bodies[i]->getIslandTag();
+        if (tag < 0 || std::size_t(tag) >= _islandSizes.size())
+            continue;
+        if (!_islandSizes[tag]++)
+            ++out.islands;
+        out.largestIsland =
+            Math::max(out.largestIsland, Int(_islandSizes[tag]));
+    }
+
+    out.solverIterations = _bWorld.getSolverInfo().m_numIterations;
+    out.substeps = _substeps;
+    out.requestedSubSteps = _requestedSubSteps;
+    out.maxSubSteps = _maxSubSteps;
+    out.clampedFrames = _clampedFrames;
+}
+
+UnsignedLong Simulation::tickCount() const {
+    return _tickCount;
+}
+
+Float Simulation::interpolation() const {
+    return _accumulator / _tickDuration;
+}
+
+Vector3 Simulation::interpolatedBallPosition() const {
+    return _interpolatedBallPosition;
+}
+
+void Simulation::tick() {
+    /* Remember the state before the tick to interpolate from */
+    btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    for (Int i = 0; i != bodies.size(); ++i)
+        if (needsUpdate(*bodies[i]))
+            static_cast<RigidBody *>(bodies[i]->getUserPointer())
+                ->beginTick();
+
+    {
+        PLAYGROUND_PROFILE(BallControls);
+        _ball->adjustVelocity(_tickDuration, _ballInputSpace, _ballInput,
+                              _ballUpAxis);
+        if (_ballJump) {
+            _ball->jump(_ballGravity, _ballUpAxis);
+            _ballJump = false;
+        }
+    }
+
+    /* With no substeps the time step is used as is */
+    step(_tickDuration, 0);
+    ++_tickCount;
+}
+
+void Simulation::writeSnapshot(SimulationSnapshot &out) const {
+    const btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    arrayResize(out.bodies, NoInit, bodies.size());
+    std::size_t count = 0;
+    for (Int i = 0; i != bodies.size(); ++i) {
+        const auto *body =
+            static_cast<const RigidBody *>(bodies[i]->getUserPointer());
+        if (!body->instances())
+            continue;
+
+        const btTransform &previous = body->previousTransform();
+        const btTransform &current = bodies[i]->getWorldTransform();
+        out.bodies[count++] = SimulationSnapshot::Body{
+            body->instances(),
+            body->instance(),
+            Vector3{previous.getOrigin()},
+            Vector3{current.getOrigin()},
+            Quaternion{previous.getRotation()},
+            Quaternion{current.getRotation()}};
+    }
+    arrayResize(out.bodies, count);
+
+    out.previousBallPosition =
+        Vector3{_ball->previousTransform().getOrigin()};
+    out.ballPosition = ballPosition();
+    out.ballGravity = _ballGravity;
+    out.ballUpAxis = _ballUpAxis;
+    out.tick = _tickCount;
+    out.tickDuration = _tickDuration;
+}
+
+void Simulation::interpolate(Float factor) {
+    btAlignedObjectArray<btRigidBody *> &bodies =
+        _bWorld.getNonStaticRigidBodies();
+    for (Int i = 0; i != bodies.size(); ++i) {
+        if (!needsUpdate(*bodies[i]))
+            continue;
+        auto *body = static_cast<RigidBody *>(bodies[i]->getUserPointer());
+        const Vector3 position = body->interpolate(factor);
+        if (body == _ball)
+            _interpolatedBallPosition = position;
+    }
+}
+
+void Simulation::preTickCallback(btDynamicsWorld *world, btScalar) {
+    PLAYGROUND_PROFILE(Gravity);
+    static_cast<Simulation *>(world->getWorldUserInfo())
+        ->_gravitySystem.apply();
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "BakedGravityField.h"
+#include "GravityFieldRegistry.h"
+#include "GravitySystem.h"
+#include "InputFrame.h"
+#include "KillVolume.h"
+#include "MovingSphere.h"
+#include "PhysicsStatistics.h"
+#include "RigidBodyPool.h"
+#include "Rigidbody.h"
+#include "SimulationSnapshot.h"
+
+#include <Magnum/SceneGraph/MatrixTransformation3D.h>
+#include <Magnum/SceneGraph/Scene.h>
+#include <btBulletDynamicsCommon.h>
+#ifdef PLAYGROUND_BULLET_MT
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#endif
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+typedef SceneGraph::Scene<SceneGraph::MatrixTransformation3D> Scene3D;
+
+/* The Bullet world, the bodies living in it and the gravity sources. Doesn't
+   depend on GL or a window, so it can be stepped headlessly as well.
+
+   With PLAYGROUND_BULLET_MT the world, the collision dispatcher and the
+   constraint solver are Bullet's multithreaded variants, running on its
+   default task scheduler, which steals work between its threads. */
+class Simulation {
+ public:
+    Simulation();
+
+    Scene3D &scene();
+    btDiscreteDynamicsWorld &world();
+
+    /* Most threads the world can be stepped with, 1 if not built with
+       PLAYGROUND_BULLET_MT */
+    static Int maxThreadCount();
+
+    /* Threads the world is stepped with, all available by default. The
+       task scheduler is shared by all simulations, so it's the same for
+       all of them. Can't be changed while a step is in progress. */
+    static Int threadCount();
+    static void setThreadCount(Int count);
+
+    RigidBody &ground();
+    MovingSphere &ball();
+
+    /* Half size of the ground box, for example to use it as an occluder */
+    Vector3 groundHalfExtents() const;
+
+    /* Gravity sources affecting all dynamic bodies, initially contains just
+       the box around the ground */
+    GravityFieldRegistry &gravityFields();
+
+    /* Samples the gravity sources into a grid of given size covering given
+       range and uses it instead of the sources from then on. Has to be done
+       again after the sources change. */
+    const BakedGravityField &bakeGravity(const Range3D &range,
+                                         const Vector3i &size);
+
+    /* Uses a previously baked field instead of the gravity sources */
+    void setBakedGravity(BakedGravityField &&field);
+
+    /* Goes back to evaluating the gravity sources directly */
+    void clearBakedGravity();
+
+    /* Null if the gravity sources are evaluated directly */
+    const BakedGravityField *bakedGravity() const;
+
+    Vector3 ballPosition() const;
+    Vector3 ballGravity() const;
+    Vector3 ballUpAxis() const;
+
+    /* Adds a dynamic unit box at the given position, at rest. Reuses a box
+       removed earlier if there's one. */
+    RigidBody *addBox(const Vector3 &position);
+
+    /* Pool the boxes come from, for example to reserve them upfront */
+    RigidBodyPool &boxes();
+
+    /* Bodies with the center outside of these bounds are removed by
+       removeDistantObjects(), 100 units around the origin by default */
+    const Range3D &killBounds() const;
+    void setKillBounds(const Range3D &bounds);
+
+    /* Removes the bodies which left the kill bounds, found from the
+       broadphase pairs of the last step, so it only costs time when
+       something is leaving. Boxes are returned to their pool. */
+    void removeDistantObjects();
+
+    /* Whether instances of removed bodies are put to removedInstances()
+       instead of being removed from their store right away, for when the
+       stores are used by another thread. Off by default. */
+    bool isInstanceRemovalDeferred() const;
+    void setInstanceRemovalDeferred(bool deferred);
+
+    /* Instances of bodies removed since the last clearRemovedInstances() */
+    Containers::ArrayView<const RemovedInstance> removedInstances() const;
+    void clearRemovedInstances();
+
+    /* Steps the Bullet world with a variable time step, gravity of all
+       dynamic bodies is updated before every substep. Neither applies the
+       ball input nor updates the instances, advance() should be used for
+       that. */
+    void step(Float timeStep, Int maxSubSteps);
+
+    /* Rate of the fixed ticks done by advance(), 60 by default */
+    Float tickRate() const;
+    void setTickRate(Float ticksPerSecond);
+
+    /* Longest frame duration advance() catches up with, anything above is
+       dropped so a slow frame doesn't cause even more ticks in the next
+       one. 0.25 seconds by default. */
+    Float maxFrameDuration() const;
+    void setMaxFrameDuration(Float seconds);
+
+    /* Input the ball is controlled with in every tick, in given space,
+       usually the camera transformation */
+    void setBallInput(const Matrix4 &inputSpace, const Vector3 &input);
+
+    /* Makes the ball jump in the next tick */
+    void jumpBall();
+
+    /* Adds the frame duration to the time left over from previous frames
+       and runs as many fixed ticks as fit into it, returns their count */
+    Int runTicks(Float frameDuration);
+
+    /* Runs the ticks like runTicks(), then updates the instances of all
+       dynamic bodies with their state interpolated between the last two
+       ticks by the time left over, so the rendering is smooth even if the
+       tick rate differs from the frame rate */
+    Int advance(Float frameDuration);
+
+    /* A whole frame of the application: removes the distant objects,
+       applies the input and advances by the frame duration. Returns the
+       ticks done. Running the same frames on a simulation with the same
+       bodies gives the same state, bit for bit, as long as the world is
+       stepped with a single thread, see setThreadCount(). */
+    Int runFrame(const InputFrame &frame);
+
+    /* Hash of the transformations of all dynamic bodies in the world, for
+       checking that a replay arrived at the same state */
+    UnsignedLong stateChecksum() const;
+
+    /* Dynamic bodies that fell asleep with their island, which Bullet
+       neither integrates nor solves until something wakes them */
+    std::size_t sleepingBodyCount() const;
+
+    /* Writes the counters of the world after the last step and the scopes
+       Bullet's profiler measured in it. Bullet keeps a profile for every
+       thread, so this has to be called from the thread that stepped. */
+    void writeStatistics(PhysicsStatistics &out);
+
+    /* Ticks done since the creation */
+    UnsignedLong tickCount() const;
+
+    /* Fraction of a tick the rendered state is behind the last tick, in the
+       [0, 1) range */
+    Float interpolation() const;
+
+    /* Position of the ball as rendered in the last advance(), the camera
+       should follow this one instead of ballPosition() */
+    Vector3 interpolatedBallPosition() const;
+
+    /* Copies the state after the last tick to given snapshot, except for
+       the time */
+    void writeSnapshot(SimulationSnapshot &out) const;
+
+ private:
+    static void preTickCallback(btDynamicsWorld *world, btScalar timeStep);
+
+    /* A single fixed step of the ball controls, the world and the gravity
+       of the ball */
+    void tick();
+
+    /* Updates the instances of all dynamic bodies with given fraction
+       between their state before and after the last tick */
+    void interpolate(Float factor);
+
+    btDbvtBroadphase _bBroadphase;
+    btDefaultCollisionConfiguration _bCollisionConfig;
+#ifdef PLAYGROUND_BULLET_MT
+    btCollisionDispatcherMt _bDispatcher{&_bCollisionConfig};
+    /* One solver per thread */
+    btConstraintSolverPoolMt _bSolver{maxThreadCount()};
+#else
+    btCollisionDispatcher _bDispatcher{&_bCollisionConfig};
+    btSequentialImpulseConstraintSolver _bSolver;
+#endif
+
+    /* The world has to live longer than the scene because RigidBody
+       instances have to remove themselves from it on destruction */
+#ifdef PLAYGROUND_BULLET_MT
+    btDiscreteDynamicsWorldMt _bWorld{&_bDispatcher, &_bBroadphase, &_bSolver,
+                                      nullptr, &_bCollisionConfig};
+#else
+    btDiscreteDynamicsWorld _bWorld{&_bDispatcher, &_bBroadphase, &_bSolver,
+                                    &_bCollisionConfig};
+#endif
+
+    btBoxShape _bBoxShape{{0.5f, 0.5f, 0.5f}};
+    btSphereShape _bSphereShape{0.5f};
+    btBoxShape _bGroundShape{{4.0f, 4.0f, 4.0f}};
+
+    GravityFieldRegistry _gravityFields;
+    Containers::Optional<BakedGravityField> _bakedGravity;
+    GravitySystem _gravitySystem{_bWorld, _gravityFields};
+
+    /* Body count of each island, reused by writeStatistics() */
+    Containers::Array<UnsignedInt> _islandSizes;
+
+    KillVolume _killVolume{_bWorld, Range3D{Vector3{-100.0f},
+                                            Vector3{100.0f}}};
+    /* Bodies removeDistantObjects() found leaving, kept to reuse the
+       memory */
+    Containers::Array<RigidBody *> _leavingBodies;
+
+    Scene3D _scene;
+    /* Destroys the boxes before the scene would try to delete them */
+    RigidBodyPool _boxes{_scene, 1.0f, _bBoxShape, _bWorld};
+
+    RigidBody *_ground;
+    MovingSphere *_ball;
+    Vector3 _ballGravity, _ballUpAxis{Vector3::yAxis()};
+    Matrix4 _ballInputSpace;
+    Vector3 _ballInput, _interpolatedBallPosition;
+    bool _ballJump{};
+
+    bool _instanceRemovalDeferred{};
+    Containers::Array<RemovedInstance> _removedInstances;
+
+    Float _tickDuration{1.0f / 60.0f}, _maxFrameDuration{0.25f};
+    /* Frame time not consumed by ticks yet */
+    Float _accumulator{};
+    UnsignedLong _tickCount{}, _clampedFrames{};
+    /* Substeps of the last step() */
+    Int _substeps{}, _requestedSubSteps{}, _maxSubSteps{};
+};
+
+}  // namespace GraphicsPlayground
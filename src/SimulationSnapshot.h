@@ -0,0 +1,51 @@
+#pragma once
+
+#include "PhysicsStatistics.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Quaternion.h>
+#include <Magnum/Math/Vector3.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class InstanceStore;
+
+/* State of the simulation after a tick, copied out so it can be rendered on
+   another thread while the next ticks run */
+struct SimulationSnapshot {
+    /* A dynamic body with an instance, in the state before and after the
+       last tick */
+    struct Body {
+        InstanceStore *instances;
+        UnsignedInt instance;
+        Vector3 previousPosition, position;
+        Quaternion previousRotation, rotation;
+    };
+
+    Containers::Array<Body> bodies;
+    Vector3 previousBallPosition, ballPosition;
+    Vector3 ballGravity, ballUpAxis{Vector3::yAxis()};
+
+    /* Counters of the world after the last tick */
+    PhysicsStatistics statistics;
+
+    /* Ticks done so far, the duration of each and the time at which the
+       last one ended, in seconds on the clock of whoever took the
+       snapshot */
+    UnsignedLong tick{};
+    Float tickDuration{};
+    Double time{};
+};
+
+/* An instance of a body removed in given tick, which is yet to be removed
+   from its store */
+struct RemovedInstance {
+    InstanceStore *instances;
+    UnsignedInt instance;
+    UnsignedLong tick;
+};
+
+}  // namespace GraphicsPlayground
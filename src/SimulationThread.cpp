@@ -0,0 +1,179 @@
+#include "SimulationThread.h"
+
+#include "InstanceStore.h"
+#include "Profiler.h"
+#include "Simulation.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+SimulationThread::SimulationThread(Simulation &simulation)
+    : _simulation(simulation) {}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+bool SimulationThread::isRunning() const {
+    return _running.load(std::memory_order_relaxed);
+}
+
+void SimulationThread::start() {
+    if (isRunning())
+        return;
+
+    /* Snapshots from a previous run may have instances that were removed
+       since */
+    _firstTick = _renderedTick = _simulation.tickCount();
+    _interpolatedBallPosition = _simulation.interpolatedBallPosition();
+    _ballUpAxis = _simulation.ballUpAxis();
+    _simulation.setInstanceRemovalDeferred(true);
+    _start = std::chrono::steady_clock::now();
+    _running.store(true, std::memory_order_release);
+    _thread = std::thread{[this] { run(); }};
+}
+
+void SimulationThread::stop() {
+    if (!isRunning())
+        return;
+
+    _running.store(false, std::memory_order_release);
+    _thread.join();
+
+    /* Everything the thread did is visible now, render its last state and
+       remove whatever is still pending */
+    update();
+    while (RemovedInstance *removed = _removedInstances.front()) {
+        removed->instances->remove(removed->instance);
+        _removedInstances.pop();
+    }
+    for (const RemovedInstance &removed : _pendingRemovals)
+        removed.instances->remove(removed.instance);
+    arrayResize(_pendingRemovals, 0);
+    for (const RemovedInstance &removed : _simulation.removedInstances())
+        removed.instances->remove(removed.instance);
+    _simulation.clearRemovedInstances();
+    _simulation.setInstanceRemovalDeferred(false);
+}
+
+bool SimulationThread::pushInput(const SimulationInput &input) {
+    return _inputs.push(input);
+}
+
+const SimulationSnapshot &SimulationThread::update() {
+    _snapshots.update();
+    const SimulationSnapshot &snapshot = _snapshots.front();
+    _updateTickCount = 0;
+    if (snapshot.tick <= _firstTick)
+        return snapshot;
+    _updateTickCount = Int(snapshot.tick - _renderedTick);
+    _renderedTick = snapshot.tick;
+
+    /* Instances are queued for removal before the snapshot of the same tick
+       is published, so all those removed until this snapshot are there
+       already and none of them are in it */
+    while (RemovedInstance *removed = _removedInstances.front()) {
+        if (removed->tick > snapshot.tick)
+            break;
+        removed->instances->remove(removed->instance);
+        _removedInstances.pop();
+    }
+
+    /* The state in between the last two ticks is rendered, like with
+       Simulation::advance() */
+    _interpolation = Math::clamp(
+        Float((time() - snapshot.time) / snapshot.tickDuration), 0.0f, 1.0f);
+    for (const SimulationSnapshot::Body &body : snapshot.bodies) {
+        if (body.previousPosition == body.position &&
+            body.previousRotation == body.rotation)
+            body.instances->setTransformation(body.instance, body.position,
+                                              body.rotation);
+        else
+            body.instances->setTransformation(
+                body.instance,
+                Math::lerp(body.previousPosition, body.position,
+                           _interpolation),
+                Math::lerpShortestPath(body.previousRotation, body.rotation,
+                                       _interpolation));
+    }
+    _interpolatedBallPosition = Math::lerp(
+        snapshot.previousBallPosition, snapshot.ballPosition, _interpolation);
+    _ballUpAxis = snapshot.ballUpAxis;
+    return snapshot;
+}
+
+Int SimulationThread::updateTickCount() const {
+    return _updateTickCount;
+}
+
+Float SimulationThread::interpolation() const {
+    return _interpolation;
+}
+
+Vector3 SimulationThread::interpolatedBallPosition() const {
+    return _interpolatedBallPosition;
+}
+
+Vector3 SimulationThread::ballUpAxis() const {
+    return _ballUpAxis;
+}
+
+void SimulationThread::run() {
+#ifdef PLAYGROUND_PROFILER
+    Profiler::setThreadName("Simulation");
+#endif
+    Double lastTime = time();
+    while (_running.load(std::memory_order_acquire)) {
+        while (SimulationInput *input = _inputs.front()) {
+            _simulation.setBallInput(input->ballInputSpace, input->ballInput);
+            if (input->jump)
+                _simulation.jumpBall();
+            if (input->tickRate != _simulation.tickRate())
+                _simulation.setTickRate(input->tickRate);
+            if (input->threadCount != Simulation::threadCount())
+                Simulation::setThreadCount(input->threadCount);
+            _inputs.pop();
+        }
+
+        const Double now = time();
+        const Int ticks = _simulation.runTicks(Float(now - lastTime));
+        lastTime = now;
+
+        if (ticks) {
+            PLAYGROUND_PROFILE(Housekeeping);
+            _simulation.removeDistantObjects();
+            arrayAppend(_pendingRemovals, _simulation.removedInstances());
+            _simulation.clearRemovedInstances();
+
+            /* Whatever doesn't fit is sent after the next ticks */
+            std::size_t pushed = 0;
+            while (pushed != _pendingRemovals.size() &&
+                   _removedInstances.push(_pendingRemovals[pushed]))
+                ++pushed;
+            for (std::size_t i = pushed; i != _pendingRemovals.size(); ++i)
+                _pendingRemovals[i - pushed] = _pendingRemovals[i];
+            arrayResize(_pendingRemovals, _pendingRemovals.size() - pushed);
+
+            SimulationSnapshot &snapshot = _snapshots.back();
+            _simulation.writeSnapshot(snapshot);
+            _simulation.writeStatistics(snapshot.statistics);
+            snapshot.time = now - Double(_simulation.interpolation() *
+                                         snapshot.tickDuration);
+            _snapshots.publish();
+        }
+
+        /* Sleep until the next tick is due */
+        std::this_thread::sleep_for(std::chrono::duration<Double>{
+            (1.0f - _simulation.interpolation()) / _simulation.tickRate()});
+    }
+}
+
+Double SimulationThread::time() const {
+    return std::chrono::duration<Double>{std::chrono::steady_clock::now() -
+                                         _start}
+        .count();
+}
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "SimulationSnapshot.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+class Simulation;
+
+/* Input for the simulation, sent from the render thread every frame */
+struct SimulationInput {
+    Matrix4 ballInputSpace;
+    Vector3 ballInput;
+    Float tickRate;
+    /* Threads Bullet steps the world with */
+    Int threadCount;
+    bool jump;
+};
+
+/* Runs the fixed ticks of a simulation on a thread of its own, so a slow
+   physics step doesn't hold up rendering and the other way around.
+
+   The render thread sends input through a lock-free queue and gets the
+   state after the newest tick through a triple buffer, interpolating the
+   instances from it by the time since. Instances of removed bodies come
+   through another queue and are removed from their stores once a snapshot
+   without them is taken, so the stores are only ever touched by the
+   render thread. While the thread runs, nothing else may use the
+   simulation. */
+class SimulationThread {
+ public:
+    explicit SimulationThread(Simulation &simulation);
+
+    /* Stops the thread */
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    bool isRunning() const;
+
+    /* Starts ticking the simulation on the thread */
+    void start();
+
+    /* Waits for the thread to finish the ticks it's on and removes all
+       pending instances, after which the simulation can be used directly
+       again */
+    void stop();
+
+    /* Queues input for the next ticks, returns false if the thread didn't
+       keep up and the queue is full */
+    bool pushInput(const SimulationInput &input);
+
+    /* Takes the newest snapshot, removes the instances of bodies removed
+       until then and updates the instances with the state interpolated for
+       the current time. Returns the snapshot. */
+    const SimulationSnapshot &update();
+
+    /* Ticks done between the last two update() calls */
+    Int updateTickCount() const;
+
+    /* Fraction of a tick the state rendered by the last update() is behind
+       the newest tick, in the [0, 1] range, and the ball position in that
+       state */
+    Float interpolation() const;
+    Vector3 interpolatedBallPosition() const;
+
+    /* Up axis at the ball after the newest tick */
+    Vector3 ballUpAxis() const;
+
+ private:
+    void run();
+
+    /* Seconds since start() */
+    Double time() const;
+
+    Simulation &_simulation;
+    std::thread _thread;
+    std::atomic<bool> _running{false};
+    std::chrono::steady_clock::time_point _start;
+
+    SpscQueue<SimulationInput> _inputs{64};
+    SpscQueue<RemovedInstance> _removedInstances{1024};
+    TripleBuffer<SimulationSnapshot> _snapshots;
+
+    /* Used by the thread only, instances that didn't fit into the queue */
+    Containers::Array<RemovedInstance> _pendingRemovals;
+
+    /* Used by the render thread only. Snapshots up to the first tick are
+       from a previous run. */
+    UnsignedLong _firstTick{}, _renderedTick{};
+    Int _updateTickCount{};
+    Float _interpolation{};
+    Vector3 _interpolatedBallPosition, _ballUpAxis;
+};
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+
+#include <atomic>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Bounded lock-free queue between exactly one producer and one consumer
+   thread. Each side writes only its own index and reads the other one, so
+   neither ever waits on the other, a full queue just refuses new items. */
+template <class T>
+class SpscQueue {
+ public:
+    /* The capacity is rounded up to a power of two */
+    explicit SpscQueue(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        _items = Containers::Array<T>{ValueInit, size};
+    }
+
+    /* Producer side. Returns false if the queue is full. */
+    bool push(const T &item) {
+        const std::size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == _items.size())
+            return false;
+        _items[tail & (_items.size() - 1)] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer side. Oldest item in the queue or null if it's empty, stays
+       there until pop(). */
+    T *front() {
+        const std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &_items[head & (_items.size() - 1)];
+    }
+
+    /* Consumer side. Expects that front() isn't null. */
+    void pop() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+ private:
+    Containers::Array<T> _items;
+    /* Next item to read, written by the consumer, and next item to write,
+       written by the producer. Padded to be on separate cache lines. */
+    std::atomic<std::size_t> _head{0};
+    char _padding[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> _tail{0};
+};
+
+}  // namespace GraphicsPlayground
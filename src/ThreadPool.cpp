@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+
+#include <Magnum/Math/Functions.h>
+
+namespace GraphicsPlayground {
+
+ThreadPool::ThreadPool(Int threadCount) {
+#ifdef PLAYGROUND_THREADS
+    if (!threadCount)
+        threadCount = Math::max(Int(std::thread::hardware_concurrency()), 1);
+    _workers = Containers::Array<std::thread>{std::size_t(threadCount - 1)};
+    for (std::size_t i = 0; i != _workers.size(); ++i)
+        _workers[i] = std::thread{[this, i] { workerLoop(Int(i) + 1); }};
+#else
+    static_cast<void>(threadCount);
+#endif
+}
+
+ThreadPool::~ThreadPool() {
+#ifdef PLAYGROUND_THREADS
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _quit = true;
+    }
+    _started.notify_all();
+    for (std::thread &worker : _workers)
+        worker.join();
+#endif
+}
+
+Int ThreadPool::threadCount() const {
+#ifdef PLAYGROUND_THREADS
+    return Int(_workers.size()) + 1;
+#else
+    return 1;
+#endif
+}
+
+void ThreadPool::runInternal(std::size_t count, std::size_t chunkSize,
+                             Function function, void *context) {
+    if (threadCount() == 1 || count <= chunkSize) {
+        function(context, 0, count);
+        return;
+    }
+
+    _function = function;
+    _context = context;
+    _count = count;
+    _chunkSize = chunkSize;
+
+#ifdef PLAYGROUND_THREADS
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _pending = Int(_workers.size());
+        ++_generation;
+    }
+    _started.notify_all();
+#endif
+
+    work(0);
+
+#ifdef PLAYGROUND_THREADS
+    std::unique_lock<std::mutex> lock{_mutex};
+    _finished.wait(lock, [this] { return !_pending; });
+#endif
+}
+
+void ThreadPool::work(Int thread) {
+    const std::size_t chunkCount = (_count + _chunkSize - 1) / _chunkSize;
+    for (std::size_t chunk = thread; chunk < chunkCount;
+         chunk += threadCount()) {
+        const std::size_t begin = chunk * _chunkSize;
+        _function(_context, begin, Math::min(begin + _chunkSize, _count));
+    }
+}
+
+#ifdef PLAYGROUND_THREADS
+void ThreadPool::workerLoop(Int thread) {
+    UnsignedInt generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _started.wait(lock, [&] {
+                return _quit || _generation != generation;
+            });
+            if (_quit)
+                return;
+            generation = _generation;
+        }
+
+        work(thread);
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (!--_pending)
+            _finished.notify_one();
+    }
+}
+#endif
+
+}  // namespace GraphicsPlayground
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Magnum.h>
+
+#include <type_traits>
+#ifdef PLAYGROUND_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Worker threads running fixed-size chunks of a loop in parallel. The
+   chunks are dealt to the threads round-robin upfront, so the threads
+   don't share anything while working, and the calling thread takes part as
+   well. run() returns once all chunks are done.
+
+   Without PLAYGROUND_THREADS, with a single thread or with a loop that
+   fits into a single chunk, everything runs serially on the calling
+   thread. */
+class ThreadPool {
+ public:
+    /* Total count including the calling thread, zero means one for each
+       hardware thread */
+    explicit ThreadPool(Int threadCount = 0);
+
+    /* Waits for the workers to exit */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    Int threadCount() const;
+
+    /* Calls f(begin, end) for consecutive chunks of [0, count) of given
+       size. Chunks of one call may run in parallel, so they shouldn't
+       write to anything shared. */
+    template <class F>
+    void run(std::size_t count, std::size_t chunkSize, F &&f) {
+        typedef typename std::remove_reference<F>::type Function;
+        runInternal(
+            count, chunkSize,
+            [](void *function, std::size_t begin, std::size_t end) {
+                (*static_cast<Function *>(function))(begin, end);
+            },
+            &f);
+    }
+
+ private:
+    typedef void (*Function)(void *, std::size_t, std::size_t);
+
+    void runInternal(std::size_t count, std::size_t chunkSize,
+                     Function function, void *context);
+
+    /* Runs the chunks dealt to given thread */
+    void work(Int thread);
+
+#ifdef PLAYGROUND_THREADS
+    void workerLoop(Int thread);
+
+    Containers::Array<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _started, _finished;
+    /* Incremented for every run(), workers wait for it to change */
+    UnsignedInt _generation{};
+    /* Workers still working on the current run() */
+    Int _pending{};
+    bool _quit{};
+#endif
+
+    /* The current run(), written before the workers are woken up */
+    Function _function{};
+    void *_context{};
+    std::size_t _count{}, _chunkSize{};
+};
+
+}  // namespace GraphicsPlayground
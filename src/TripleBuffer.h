@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Magnum/Magnum.h>
+
+#include <atomic>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Hands the newest of a series of values from one producer thread to one
+   consumer thread without locks. The producer writes to its own slot and
+   swaps it with the middle one, the consumer swaps its own slot with the
+   middle one if that got newer. Neither side ever waits, values the
+   consumer didn't get to in time are overwritten.
+
+   The slots are reused, so values with growable arrays don't allocate once
+   they're large enough. */
+template <class T>
+class TripleBuffer {
+ public:
+    /* Producer side. Slot to write the next value to. */
+    T &back() {
+        return _slots[_back];
+    }
+
+    /* Producer side. Makes the value in back() the newest one and gives
+       back() another slot, with a stale value in it. */
+    void publish() {
+        _back = _middle.exchange(_back | Fresh, std::memory_order_acq_rel) &
+                IndexMask;
+    }
+
+    /* Consumer side. Takes the newest value if there's one it didn't take
+       yet, returns whether it did. */
+    bool update() {
+        if (!(_middle.load(std::memory_order_relaxed) & Fresh))
+            return false;
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) &
+                 IndexMask;
+        return true;
+    }
+
+    /* Consumer side. Value taken by the last update(), a default-constructed
+       one before that. */
+    const T &front() const {
+        return _slots[_front];
+    }
+
+ private:
+    enum : UnsignedInt { IndexMask = 3, Fresh = 4 };
+
+    T _slots[3];
+    UnsignedInt _back{0}, _front{1};
+    /* Index of the middle slot, with the Fresh bit set if the producer
+       published into it since the consumer last took it */
+    std::atomic<UnsignedInt> _middle{2};
+};
+
+}  // namespace GraphicsPlayground
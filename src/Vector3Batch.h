@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Magnum.h>
+
+namespace GraphicsPlayground {
+
+using namespace Magnum;
+
+/* Structure-of-arrays view on a batch of 3D vectors, all three components
+   are expected to have the same size */
+template <class T>
+struct BasicVector3Batch {
+    Containers::ArrayView<T> x, y, z;
+
+    std::size_t size() const {
+        return x.size();
+    }
+};
+
+typedef BasicVector3Batch<Float> Vector3Batch;
+typedef BasicVector3Batch<const Float> ConstVector3Batch;
+
+}  // namespace GraphicsPlayground
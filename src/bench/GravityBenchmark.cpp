@@ -0,0 +1,133 @@
+#include "GravityBox.h"
+#include "Simd.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Vector3.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+
+namespace {
+
+/* Owns the memory behind a Vector3Batch */
+struct Vector3Storage {
+    explicit Vector3Storage(std::size_t size)
+        : x{NoInit, size}, y{NoInit, size}, z{NoInit, size} {}
+
+    Vector3Batch batch() {
+        return {x, y, z};
+    }
+    ConstVector3Batch constBatch() const {
+        return {x, y, z};
+    }
+
+    Containers::Array<Float> x, y, z;
+};
+
+template <class F>
+Double measure(Int iterations, F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (Int i = 0; i != iterations; ++i)
+        f();
+    return std::chrono::duration<Double, std::nano>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addOption("count", "10000")
+        .setHelp("count", "number of positions to evaluate", "N")
+        .addOption("iterations", "200")
+        .setHelp("iterations", "number of times to evaluate all positions",
+                 "N")
+        .setGlobalHelp("Compares the scalar and the batched GravityBox "
+                       "evaluation and reports the timings as JSON.")
+        .parse(argc, argv);
+
+    const std::size_t count = Math::max(args.value<Int>("count"), 1);
+    const Int iterations = Math::max(args.value<Int>("iterations"), 1);
+
+    /* Same parameters as the box in the playground */
+    GravityBox gravityBox{19.62f, Vector3{4.0f, 4.0f, 4.0f}, 0.0f, 0.0f, 8.0f,
+                          12.0f};
+
+    /* Positions spread over the inside, the outside and the falloff region
+       of the box */
+    Vector3Storage positions{count};
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<Float> distribution{-16.0f, 16.0f};
+    for (std::size_t i = 0; i != count; ++i) {
+        positions.x[i] = distribution(rng);
+        positions.y[i] = distribution(rng);
+        positions.z[i] = distribution(rng);
+    }
+
+    Vector3Storage scalarGravity{count}, scalarUpAxes{count};
+    const Double scalar = measure(iterations, [&] {
+        for (std::size_t i = 0; i != count; ++i) {
+            Vector3 upAxis;
+            const Vector3 g = gravityBox.getGravity(
+                Vector3{positions.x[i], positions.y[i], positions.z[i]},
+                &upAxis);
+            scalarGravity.x[i] = g.x();
+            scalarGravity.y[i] = g.y();
+            scalarGravity.z[i] = g.z();
+            scalarUpAxes.x[i] = upAxis.x();
+            scalarUpAxes.y[i] = upAxis.y();
+            scalarUpAxes.z[i] = upAxis.z();
+        }
+    });
+
+    Vector3Storage batchGravity{count}, batchUpAxes{count};
+    const Double batch = measure(iterations, [&] {
+        gravityBox.getGravity(positions.constBatch(), batchGravity.batch(),
+                              batchUpAxes.batch());
+    });
+
+    Vector3Storage gravityOnly{count};
+    const Double batchGravityOnly = measure(iterations, [&] {
+        gravityBox.getGravity(positions.constBatch(), gravityOnly.batch());
+    });
+
+    /* Both variants should agree up to rounding. Positions with zero gravity
+       have NaN up axes in both, those are skipped. */
+    Float maxGravityError = 0.0f, maxUpAxisError = 0.0f;
+    for (std::size_t i = 0; i != count; ++i) {
+        const Vector3 gravityError{scalarGravity.x[i] - batchGravity.x[i],
+                                   scalarGravity.y[i] - batchGravity.y[i],
+                                   scalarGravity.z[i] - batchGravity.z[i]};
+        maxGravityError = Math::max(maxGravityError, gravityError.length());
+
+        if (std::isnan(scalarUpAxes.x[i]))
+            continue;
+        const Vector3 upAxisError{scalarUpAxes.x[i] - batchUpAxes.x[i],
+                                  scalarUpAxes.y[i] - batchUpAxes.y[i],
+                                  scalarUpAxes.z[i] - batchUpAxes.z[i]};
+        maxUpAxisError = Math::max(maxUpAxisError, upAxisError.length());
+    }
+
+    const Double evaluations = Double(count) * iterations;
+    std::printf("{\n  \"count\": %zu,\n  \"iterations\": %d,\n"
+                "  \"simdWidth\": %zu,\n"
+                "  \"scalarNsPerBody\": %.3f,\n"
+                "  \"batchNsPerBody\": %.3f,\n"
+                "  \"batchGravityOnlyNsPerBody\": %.3f,\n"
+                "  \"speedup\": %.2f,\n"
+                "  \"maxGravityError\": %g,\n"
+                "  \"maxUpAxisError\": %g\n}\n",
+                count, iterations, Simd::Width, scalar / evaluations,
+                batch / evaluations, batchGravityOnly / evaluations,
+                scalar / batch, Double(maxGravityError),
+                Double(maxUpAxisError));
+    return 0;
+}
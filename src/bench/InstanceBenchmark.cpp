@@ -0,0 +1,227 @@
+#include "ColoredDrawable.h"
+#include "InstanceStore.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Quaternion.h>
+#include <Magnum/SceneGraph/Camera.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+
+namespace {
+
+constexpr const Int DefaultInstanceCounts[]{10000, 100000};
+
+/* Share of instances that move every frame in the partitioned case */
+constexpr Float MovingFraction = 0.01f;
+
+template <class F>
+Double measure(Int iterations, F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (Int i = 0; i != iterations; ++i)
+        f();
+    return std::chrono::duration<Double, std::nano>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+/* Largest absolute difference between the matrices of both paths. The
+   normal matrices are only equal up to a scale, the drawables use the
+   cofactor matrix, which is s^2 R for a uniform scale s, while the store
+   uses R / s. The shader normalizes the normals, so only the directions of
+   the columns are compared. */
+Float maxDifference(Containers::ArrayView<const InstanceData> a,
+                    Containers::ArrayView<const InstanceData> b) {
+    Float difference = 0.0f;
+    for (std::size_t i = 0; i != a.size(); ++i) {
+        for (Int col = 0; col != 4; ++col)
+            difference = Math::max(
+                difference, Math::abs(a[i].transformationMatrix[col] -
+                                      b[i].transformationMatrix[col])
+                                .max());
+        for (Int col = 0; col != 3; ++col)
+            difference = Math::max(
+                difference, Math::abs(a[i].normalMatrix[col].normalized() -
+                                      b[i].normalMatrix[col].normalized())
+                                .max());
+    }
+    return difference;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addArrayOption("instances")
+        .setHelp("instances",
+                 "number of instances, can be specified multiple times "
+                 "(default: 10000 and 100000)",
+                 "N")
+        .addOption("iterations", "100")
+        .setHelp("iterations", "number of times to build the instance data",
+                 "N")
+        .addOption("threads", "0")
+        .setHelp("threads",
+                 "threads to build the instance data with in parallel, "
+                 "including the main one (default: one per hardware thread)",
+                 "N")
+        .setGlobalHelp("Compares building the instance data through the "
+                       "ColoredDrawable scene graph traversal and through "
+                       "an InstanceStore, serially and in parallel, and "
+                       "reports the timings as JSON.")
+        .parse(argc, argv);
+
+    const Int iterations = Math::max(args.value<Int>("iterations"), 1);
+    ThreadPool pool{Math::max(args.value<Int>("threads"), 0)};
+
+    Containers::Array<Int> instanceCounts;
+    if (args.arrayValueCount("instances")) {
+        instanceCounts = Containers::Array<Int>{
+            NoInit, args.arrayValueCount("instances")};
+        for (std::size_t i = 0; i != instanceCounts.size(); ++i)
+            instanceCounts[i] = args.arrayValue<Int>("instances", i);
+    } else {
+        instanceCounts = Containers::Array<Int>{
+            NoInit, Containers::arraySize(DefaultInstanceCounts)};
+        std::copy(std::begin(DefaultInstanceCounts),
+                  std::end(DefaultInstanceCounts), instanceCounts.begin());
+    }
+
+    std::printf("[\n");
+    for (std::size_t c = 0; c != instanceCounts.size(); ++c) {
+        const std::size_t count = Math::max(instanceCounts[c], 1);
+
+        /* The camera is at the origin, so both paths produce the same
+           transformations, and normal matrices differing only in scale */
+        Scene3D scene;
+        SceneGraph::Camera3D camera{*new Object3D{&scene}};
+        SceneGraph::DrawableGroup3D drawables;
+        Containers::Array<InstanceData> drawableData;
+        InstanceStore store;
+        Containers::Array<UnsignedInt> handles;
+
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<Float> position{-50.0f, 50.0f};
+        std::uniform_real_distribution<Float> angle{0.0f, 360.0f};
+        for (std::size_t i = 0; i != count; ++i) {
+            const Vector3 translation{position(rng), position(rng),
+                                      position(rng)};
+            const Quaternion rotation = Quaternion::rotation(
+                Deg(angle(rng)),
+                Vector3{position(rng), position(rng), 1.0f}.normalized());
+            const Color3 color{0.5f, 0.5f, 0.5f};
+
+            auto *object = new Object3D{&scene};
+            object->setTransformation(
+                Matrix4::from(rotation.toMatrix(), translation));
+            new ColoredDrawable{*object, drawableData, color,
+                                Matrix4::scaling(Vector3{0.5f}), drawables};
+
+            const UnsignedInt handle = store.add(color, 0.5f);
+            store.setTransformation(handle, translation, rotation);
+            arrayAppend(handles, handle);
+        }
+
+        /* Same as Application::drawEvent() did before */
+        const Double drawable = measure(iterations, [&] {
+            arrayResize(drawableData, 0);
+            camera.draw(drawables);
+        });
+
+        Containers::Array<InstanceData> storeData;
+        const Double flat = measure(iterations, [&] {
+            arrayResize(storeData, NoInit, store.size());
+            store.fillInstanceData(storeData);
+        });
+
+        Containers::Array<CompactInstanceData> compactData;
+        const Double compact = measure(iterations, [&] {
+            arrayResize(compactData, NoInit, store.size());
+            store.fillInstanceData(compactData);
+        });
+
+        /* Same with the chunks spread across the pool, the output has to be
+           the same */
+        store.setThreadPool(&pool);
+        Containers::Array<InstanceData> parallelData;
+        const Double parallel = measure(iterations, [&] {
+            arrayResize(parallelData, NoInit, store.size());
+            store.fillInstanceData(parallelData);
+        });
+        const Double parallelCompact = measure(iterations, [&] {
+            arrayResize(compactData, NoInit, store.size());
+            store.fillInstanceData(compactData);
+        });
+        store.setThreadPool(nullptr);
+
+        /* A few instances move each frame, the rest settles into the static
+           partition. Only the dynamic instances and the changed static
+           ranges are built, like InstancedMesh does. */
+        const std::size_t movingCount =
+            Math::max(std::size_t(count * MovingFraction), std::size_t{1});
+        for (UnsignedInt i = 0; i <= store.staticFrameCount(); ++i)
+            store.update();
+        std::size_t partitionedInstances = 0;
+        Int frame = 0;
+        const Double partitioned = measure(iterations, [&] {
+            ++frame;
+            for (std::size_t i = 0; i != movingCount; ++i) {
+                const UnsignedInt handle = handles[(i * 7919) % count];
+                store.setTransformation(handle, Vector3{Float(frame)},
+                                        Quaternion{});
+            }
+            store.update();
+
+            for (const Range1Di &range : store.staticUpdates()) {
+                arrayResize(compactData, NoInit, std::size_t(range.size()));
+                store.fillInstanceData(compactData, range.min());
+                partitionedInstances += compactData.size();
+            }
+            arrayResize(compactData, NoInit,
+                        store.size() - store.staticCount());
+            store.fillInstanceData(compactData, store.staticCount());
+            partitionedInstances += compactData.size();
+        });
+
+        const Double evaluations = Double(count) * iterations;
+        std::printf("  {\"instances\": %zu, \"iterations\": %d, "
+                    "\"drawableNsPerInstance\": %.3f, "
+                    "\"storeNsPerInstance\": %.3f, "
+                    "\"compactNsPerInstance\": %.3f, \"speedup\": %.2f, "
+                    "\"threads\": %d, \"parallelNsPerInstance\": %.3f, "
+                    "\"parallelCompactNsPerInstance\": %.3f, "
+                    "\"parallelSpeedup\": %.2f, "
+                    "\"movingInstances\": %zu, "
+                    "\"partitionedNsPerInstance\": %.3f, "
+                    "\"partitionedInstancesPerFrame\": %.1f, "
+                    "\"bytesPerInstance\": %zu, "
+                    "\"compactBytesPerInstance\": %zu, "
+                    "\"maxDifference\": %g, "
+                    "\"parallelMaxDifference\": %g}%s\n",
+                    count, iterations, drawable / evaluations,
+                    flat / evaluations, compact / evaluations,
+                    drawable / flat, pool.threadCount(),
+                    parallel / evaluations, parallelCompact / evaluations,
+                    compact / parallelCompact, movingCount,
+                    partitioned / evaluations,
+                    Double(partitionedInstances) / iterations,
+                    sizeof(InstanceData),
+                    sizeof(CompactInstanceData),
+                    Double(maxDifference(drawableData, storeData)),
+                    Double(maxDifference(storeData, parallelData)),
+                    c + 1 == instanceCounts.size() ? "" : ",");
+    }
+    std::printf("]\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+using namespace Math::Literals;
+
+namespace {
+
+/* Same cube as Primitives::cubeSolid(), without the normals */
+constexpr const Vector3 CubePositions[]{
+    {-1.0f, -1.0f, -1.0f}, {1.0f, -1.0f, -1.0f}, {-1.0f, 1.0f, -1.0f},
+    {1.0f, 1.0f, -1.0f},   {-1.0f, -1.0f, 1.0f}, {1.0f, -1.0f, 1.0f},
+    {-1.0f, 1.0f, 1.0f},   {1.0f, 1.0f, 1.0f}};
+constexpr const UnsignedInt CubeIndices[]{
+    0, 1, 3, 0, 3, 2, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+    2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 3, 7, 1, 7, 5};
+
+template <class F>
+Double measure(Int iterations, F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (Int i = 0; i != iterations; ++i)
+        f();
+    return std::chrono::duration<Double, std::nano>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addOption("count", "10000")
+        .setHelp("count", "number of instances", "N")
+        .addOption("iterations", "100")
+        .setHelp("iterations", "number of culled frames", "N")
+        .setGlobalHelp("Culls boxes scattered around the ground box against "
+                       "the view frustum and then the ground as an occluder, "
+                       "with the camera looking at the ground from the "
+                       "side, and reports the counts and timings as JSON.")
+        .parse(argc, argv);
+
+    const std::size_t count = Math::max(args.value<Int>("count"), 1);
+    const Int iterations = Math::max(args.value<Int>("iterations"), 1);
+
+    /* Same radius and scale as the boxes in the playground */
+    const Float radius = Constants::sqrt3();
+    Containers::Array<Vector3> translations{NoInit, count};
+    Containers::Array<Float> scales{NoInit, count};
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<Float> distribution{-16.0f, 16.0f};
+    for (std::size_t i = 0; i != count; ++i) {
+        translations[i] = Vector3{distribution(rng), distribution(rng),
+                                  distribution(rng)};
+        scales[i] = 0.5f;
+    }
+
+    const Matrix4 projectionCameraMatrix =
+        Matrix4::perspectiveProjection(60.0_degf, 16.0f / 9.0f, 0.3f,
+                                       100.0f) *
+        Matrix4::lookAt({0.0f, 2.0f, 14.0f}, {}, Vector3::yAxis())
+            .invertedRigid();
+    const FrustumCuller culler{projectionCameraMatrix};
+    OcclusionCuller occlusionCuller;
+
+    Containers::Array<UnsignedInt> visible;
+    std::size_t inFrustum = 0, notOccluded = 0;
+    const Double frustum = measure(iterations, [&] {
+        arrayResize(visible, 0);
+        inFrustum = culler.cull(translations, scales, radius, 0, visible);
+    });
+
+    const Double rasterization = measure(iterations, [&] {
+        occlusionCuller.clear(projectionCameraMatrix);
+        occlusionCuller.addOccluder(CubePositions, CubeIndices,
+                                    Matrix4::scaling(Vector3{4.0f}));
+    });
+
+    /* Culling is destructive, so each iteration starts from a copy */
+    Containers::Array<UnsignedInt> candidates{NoInit, visible.size()};
+    const Double occlusion = measure(iterations, [&] {
+        Utility::copy(visible, candidates);
+        notOccluded =
+            occlusionCuller.cull(translations, scales, radius, candidates);
+    });
+
+    std::printf("{\"instances\": %zu, \"iterations\": %d, "
+                "\"bufferSize\": [%d, %d], \"inFrustum\": %zu, "
+                "\"occluded\": %zu, \"frustumNsPerInstance\": %.3f, "
+                "\"rasterizationUs\": %.3f, "
+                "\"occlusionNsPerInstance\": %.3f}\n",
+                count, iterations, occlusionCuller.size().x(),
+                occlusionCuller.size().y(), inFrustum,
+                inFrustum - notOccluded,
+                frustum / (Double(count) * iterations),
+                rasterization / (1000.0 * iterations),
+                occlusion / (Double(Math::max(inFrustum, std::size_t{1})) *
+                             iterations));
+    return 0;
+}
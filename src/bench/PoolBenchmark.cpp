@@ -0,0 +1,135 @@
+#include "Simulation.h"
+
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/BulletIntegration/Integration.h>
+#include <Magnum/Math/Functions.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+
+namespace {
+
+/* Allocations through operator new and through Bullet's allocator, which
+   all of Bullet's containers and objects go through */
+std::size_t allocations = 0, bulletAllocations = 0;
+
+void *bulletAllocate(std::size_t size) {
+    ++bulletAllocations;
+    return std::malloc(size);
+}
+
+void bulletFree(void *pointer) {
+    std::free(pointer);
+}
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    std::abort();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addOption("rate", "5000")
+        .setHelp("rate", "boxes spawned per second", "N")
+        .addOption("ticks", "600")
+        .setHelp("ticks", "number of measured ticks", "N")
+        .addOption("warmup", "180")
+        .setHelp("warmup",
+                 "number of ticks before measuring, enough for the first "
+                 "boxes to be removed",
+                 "N")
+        .addOption("reserve", "0")
+        .setHelp("reserve", "boxes to construct upfront", "N")
+        .setGlobalHelp("Spawns boxes around the ground flying outwards, so "
+                       "they get removed as distant objects and recycled, "
+                       "and reports the heap allocations per tick once the "
+                       "pool has grown as JSON.")
+        .parse(argc, argv);
+
+    const Int rate = Math::max(args.value<Int>("rate"), 1);
+    const Int ticks = Math::max(args.value<Int>("ticks"), 1);
+    const Int warmup = Math::max(args.value<Int>("warmup"), 0);
+
+    /* Has to be set before Bullet allocates anything */
+    btAlignedAllocSetCustom(bulletAllocate, bulletFree);
+
+    Containers::Pointer<Simulation> simulation{new Simulation};
+    simulation->boxes().reserve(
+        std::size_t(Math::max(args.value<Int>("reserve"), 0)));
+    const Float tickDuration = 1.0f / simulation->tickRate();
+
+    /* Fast enough to leave the 100 unit radius in a bit over half a second,
+       spread out so they rarely collide */
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<Float> direction{-1.0f, 1.0f};
+    Float spawnAccumulator = 0.0f;
+    std::size_t spawned = 0;
+    bool spawning = true;
+    auto tick = [&] {
+        if (spawning)
+            spawnAccumulator += Float(rate) * tickDuration;
+        for (; spawnAccumulator >= 1.0f; spawnAccumulator -= 1.0f) {
+            Vector3 d{direction(rng), direction(rng), direction(rng)};
+            if (d.isZero())
+                d = Vector3::xAxis();
+            d = d.normalized();
+            RigidBody *box = simulation->addBox(d * 12.0f);
+            box->rigidBody().setLinearVelocity(btVector3{d * 150.0f});
+            ++spawned;
+        }
+        simulation->step(tickDuration, 0);
+        simulation->removeDistantObjects();
+    };
+
+    for (Int i = 0; i != warmup; ++i)
+        tick();
+
+    const std::size_t allocationsBefore = allocations;
+    const std::size_t bulletAllocationsBefore = bulletAllocations;
+    const std::size_t spawnedBefore = spawned;
+    const auto start = std::chrono::steady_clock::now();
+    for (Int i = 0; i != ticks; ++i)
+        tick();
+    const Double duration = std::chrono::duration<Double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    const RigidBodyPool &boxes = simulation->boxes();
+    const std::size_t activeBoxes = boxes.size() - boxes.parkedCount();
+    const std::size_t pooledBoxes = boxes.size();
+
+    /* Without new boxes taking the parked ones, the boxes that left in the
+       last ticks stay parked in the slabs for several steps, which must not
+       release them again. A box released twice would be in the pool's list
+       twice. */
+    spawning = false;
+    for (Int i = 0; i != 3; ++i)
+        tick();
+    const bool consistent = boxes.parkedCount() <= boxes.size();
+    std::printf("{\"rate\": %d, \"ticks\": %d, \"spawned\": %zu, "
+                "\"activeBoxes\": %zu, \"pooledBoxes\": %zu, "
+                "\"slabs\": %zu, \"msPerTick\": %.3f, "
+                "\"allocationsPerTick\": %.3f, "
+                "\"bulletAllocationsPerTick\": %.3f, "
+                "\"consistent\": %s}\n",
+                rate, ticks, spawned - spawnedBefore,
+                activeBoxes, pooledBoxes, boxes.slabCount(), duration / ticks,
+                Double(allocations - allocationsBefore) / ticks,
+                Double(bulletAllocations - bulletAllocationsBefore) / ticks,
+                consistent ? "true" : "false");
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+#include "Simulation.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/Math/Functions.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+
+namespace {
+
+constexpr const Int DefaultBodyCounts[]{8, 1000, 10000, 50000};
+
+/* Thread counts of the scaling report, the ones above the hardware limit
+   are skipped */
+constexpr const Int DefaultThreadCounts[]{1, 2, 4, 8};
+
+/* Lays out the boxes in a cube-shaped grid, centered above the ground */
+void addBoxes(Simulation &simulation, Int count) {
+    const Int side = Int(std::ceil(std::cbrt(Float(count))));
+    const Float spacing = 1.1f;
+    const Float offset = -0.5f * spacing * Float(side - 1);
+
+    Int added = 0;
+    for (Int j = 0; j != side && added != count; ++j) {
+        for (Int i = 0; i != side && added != count; ++i) {
+            for (Int k = 0; k != side && added != count; ++k, ++added) {
+                simulation.addBox({offset + i * spacing, 5.0f + j * spacing,
+                                   offset + k * spacing});
+            }
+        }
+    }
+}
+
+/* Nearest-rank percentile of an already sorted array */
+Double percentile(Containers::ArrayView<const Double> sorted, Double p) {
+    const std::size_t rank = std::size_t(std::ceil(p * Double(sorted.size())));
+    return sorted[std::min(std::max(rank, std::size_t{1}), sorted.size()) - 1];
+}
+
+/* Counters of a step as JSON object members, each on a line of its own */
+void printStatistics(const PhysicsStatistics &statistics,
+                     const char *indent) {
+    std::printf("%s\"overlappingPairs\": %d,\n%s\"manifolds\": %d,\n"
+                "%s\"contactPoints\": %d,\n%s\"islands\": %d,\n"
+                "%s\"largestIsland\": %d,\n%s\"activeBodies\": %d,\n"
+                "%s\"solverIterations\": %d,\n%s\"substeps\": %d,\n"
+                "%s\"requestedSubSteps\": %d,\n",
+                indent, statistics.overlappingPairs, indent,
+                statistics.manifolds, indent, statistics.contactPoints,
+                indent, statistics.islands, indent, statistics.largestIsland,
+                indent, statistics.activeBodies, indent,
+                statistics.solverIterations, indent, statistics.substeps,
+                indent, statistics.requestedSubSteps);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addArrayOption("bodies")
+        .setHelp("bodies",
+                 "number of boxes to simulate, can be specified multiple "
+                 "times (default: 8, 1000, 10000 and 50000)",
+                 "N")
+        .addOption("steps", "600")
+        .setHelp("steps", "number of measured steps", "N")
+        .addOption("warmup", "60")
+        .setHelp("warmup", "number of steps before measuring", "N")
+        .addOption("time-step", "0.016666667")
+        .setHelp("time-step", "duration of a step in seconds", "SECONDS")
+        .addOption("max-substeps", "1")
+        .setHelp("max-substeps", "maximum number of Bullet substeps", "N")
+        .addArrayOption("threads")
+        .setHelp("threads",
+                 "number of threads to step with, can be specified multiple "
+                 "times (default: 1, 2, 4 and 8, up to what's available)",
+                 "N")
+        .setGlobalHelp("Steps the physics and gravity loop of the playground "
+                       "without a window and reports the timings as JSON. "
+                       "With multithreaded Bullet, each body count is "
+                       "stepped with each thread count and the speedup "
+                       "over the first one is reported. Physics counters "
+                       "are reported after the last step, together with "
+                       "their peaks, the steps that had to clamp their "
+                       "substeps and Bullet's profile of the slowest "
+                       "step.")
+        .parse(argc, argv);
+
+    const Int steps = Math::max(args.value<Int>("steps"), 1);
+    const Int warmup = Math::max(args.value<Int>("warmup"), 0);
+    const Float timeStep = args.value<Float>("time-step");
+    const Int maxSubSteps = args.value<Int>("max-substeps");
+
+    Containers::Array<Int> bodyCounts;
+    if (args.arrayValueCount("bodies")) {
+        bodyCounts = Containers::Array<Int>{NoInit,
+                                            args.arrayValueCount("bodies")};
+        for (std::size_t i = 0; i != bodyCounts.size(); ++i)
+            bodyCounts[i] = args.arrayValue<Int>("bodies", i);
+    } else {
+        bodyCounts = Containers::Array<Int>{
+            NoInit, Containers::arraySize(DefaultBodyCounts)};
+        std::copy(std::begin(DefaultBodyCounts), std::end(DefaultBodyCounts),
+                  bodyCounts.begin());
+    }
+
+    /* Thread counts above the limit would all run with the limit */
+    Containers::Array<Int> threadCounts;
+    if (args.arrayValueCount("threads")) {
+        for (std::size_t i = 0; i != args.arrayValueCount("threads"); ++i)
+            arrayAppend(threadCounts,
+                        Math::clamp(args.arrayValue<Int>("threads", i), 1,
+                                    Simulation::maxThreadCount()));
+    } else {
+        for (const Int count : DefaultThreadCounts)
+            if (count <= Simulation::maxThreadCount())
+                arrayAppend(threadCounts, count);
+    }
+
+    std::printf("{\n  \"steps\": %d,\n  \"warmup\": %d,\n  \"timeStep\": %g,\n"
+                "  \"maxSubSteps\": %d,\n  \"maxThreads\": %d,\n"
+                "  \"results\": [",
+                steps, warmup, Double(timeStep), maxSubSteps,
+                Simulation::maxThreadCount());
+
+    for (std::size_t c = 0; c != bodyCounts.size(); ++c) {
+        Double baseline = 0.0;
+        for (std::size_t t = 0; t != threadCounts.size(); ++t) {
+            Simulation::setThreadCount(threadCounts[t]);
+
+            /* The world with tens of thousands of bodies is rather large,
+               keep it on the heap */
+            Containers::Pointer<Simulation> simulation{new Simulation};
+            addBoxes(*simulation, bodyCounts[c]);
+
+            for (Int i = 0; i != warmup; ++i) {
+                simulation->removeDistantObjects();
+                simulation->step(timeStep, maxSubSteps);
+            }
+
+            /* Counters are taken outside of the measured time. The slowest
+               step keeps its own, swapped in to reuse the memory. */
+            PhysicsStatistics statistics, slowest;
+            Int peakPairs = 0, peakContactPoints = 0, clampedSteps = 0;
+            Double slowestTime = -1.0;
+            Containers::Array<Double> times{NoInit, std::size_t(steps)};
+            for (Int i = 0; i != steps; ++i) {
+                const auto start = std::chrono::steady_clock::now();
+                simulation->removeDistantObjects();
+                simulation->step(timeStep, maxSubSteps);
+                times[i] = std::chrono::duration<Double, std::milli>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+                simulation->writeStatistics(statistics);
+                peakPairs = Math::max(peakPairs, statistics.overlappingPairs);
+                peakContactPoints =
+                    Math::max(peakContactPoints, statistics.contactPoints);
+                if (statistics.requestedSubSteps > statistics.substeps)
+                    ++clampedSteps;
+                if (times[i] > slowestTime) {
+                    slowestTime = times[i];
+                    std::swap(statistics, slowest);
+                }
+            }
+            /* The last step may have just been swapped away */
+            simulation->writeStatistics(statistics);
+
+            Double total = 0.0;
+            for (Double time : times)
+                total += time;
+            std::sort(times.begin(), times.end());
+            if (!t)
+                baseline = total;
+
+            std::printf("%s\n    {\n      \"bodies\": %d,\n"
+                        "      \"threads\": %d,\n"
+                        "      \"collisionObjects\": %d,\n"
+                        "      \"sleepingBodies\": %zu,\n"
+                        "      \"meanMs\": %.4f,\n      \"p50Ms\": %.4f,\n"
+                        "      \"p99Ms\": %.4f,\n"
+                        "      \"stepsPerSecond\": %.2f,\n"
+                        "      \"speedup\": %.2f,\n",
+                        c || t ? "," : "", bodyCounts[c], threadCounts[t],
+                        simulation->world().getNumCollisionObjects(),
+                        simulation->sleepingBodyCount(),
+                        total / steps, percentile(times, 0.5),
+                        percentile(times, 0.99), steps * 1000.0 / total,
+                        baseline / total);
+            printStatistics(statistics, "      ");
+            std::printf("      \"peakOverlappingPairs\": %d,\n"
+                        "      \"peakContactPoints\": %d,\n"
+                        "      \"clampedSteps\": %d,\n"
+                        "      \"slowestStep\": {\n"
+                        "        \"ms\": %.4f,\n",
+                        peakPairs, peakContactPoints, clampedSteps,
+                        slowestTime);
+            printStatistics(slowest, "        ");
+            std::printf("        \"bulletProfile\": [");
+            for (std::size_t i = 0; i != slowest.profile.size(); ++i) {
+                const PhysicsStatistics::ProfileScope &scope =
+                    slowest.profile[i];
+                std::printf("%s\n          {\"name\": \"%s\", "
+                            "\"depth\": %d, \"calls\": %d, "
+                            "\"ms\": %.4f}",
+                            i ? "," : "", scope.name, scope.depth,
+                            scope.calls, Double(scope.milliseconds));
+            }
+            std::printf("%s]\n      }\n    }",
+                        slowest.profile.isEmpty() ? "" : "\n        ");
+            std::fflush(stdout);
+        }
+    }
+
+    std::printf("\n  ]\n}\n");
+    return 0;
+}
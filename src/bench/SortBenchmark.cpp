@@ -0,0 +1,168 @@
+#include "DepthSorter.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Algorithms.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+using namespace Math::Literals;
+
+namespace {
+
+constexpr const Int DefaultInstanceCounts[]{10000, 100000};
+
+/* Share of instances that move every frame */
+constexpr Float MovingFraction = 0.01f;
+
+/* Camera rotation around the instances every frame */
+constexpr Deg OrbitStep = 0.5_degf;
+
+template <class F>
+Double measure(Int iterations, F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (Int i = 0; i != iterations; ++i)
+        f(i);
+    return std::chrono::duration<Double, std::nano>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addArrayOption("instances")
+        .setHelp("instances",
+                 "number of instances, can be specified multiple times "
+                 "(default: 10000 and 100000)",
+                 "N")
+        .addOption("iterations", "100")
+        .setHelp("iterations", "number of sorted frames", "N")
+        .setGlobalHelp("Sorts instances front to back for a camera slowly "
+                       "orbiting around them, with std::sort, with the radix "
+                       "sort from scratch every frame and with the "
+                       "incremental DepthSorter, and reports the timings as "
+                       "JSON.")
+        .parse(argc, argv);
+
+    const Int iterations = Math::max(args.value<Int>("iterations"), 1);
+
+    Containers::Array<Int> instanceCounts;
+    if (args.arrayValueCount("instances")) {
+        instanceCounts = Containers::Array<Int>{
+            NoInit, args.arrayValueCount("instances")};
+        for (std::size_t i = 0; i != instanceCounts.size(); ++i)
+            instanceCounts[i] = args.arrayValue<Int>("instances", i);
+    } else {
+        instanceCounts = Containers::Array<Int>{
+            NoInit, Containers::arraySize(DefaultInstanceCounts)};
+        std::copy(std::begin(DefaultInstanceCounts),
+                  std::end(DefaultInstanceCounts), instanceCounts.begin());
+    }
+
+    std::printf("[\n");
+    for (std::size_t c = 0; c != instanceCounts.size(); ++c) {
+        const std::size_t count = Math::max(instanceCounts[c], 1);
+        const std::size_t moving =
+            Math::max(std::size_t(count * MovingFraction), std::size_t{1});
+
+        std::mt19937 rng{42};
+        std::uniform_real_distribution<Float> position{-50.0f, 50.0f};
+        std::uniform_real_distribution<Float> offset{-0.1f, 0.1f};
+        Containers::Array<Vector3> centers{NoInit, count};
+        for (Vector3 &center : centers)
+            center = Vector3{position(rng), position(rng), position(rng)};
+
+        /* Every variant sees the same frames, starting from the same
+           state */
+        Containers::Array<Vector3> initialCenters{NoInit, count};
+        Utility::copy(centers, initialCenters);
+        auto frame = [&](Int i, Vector3 &cameraPosition,
+                         Vector3 &viewDirection) {
+            for (std::size_t j = 0; j != moving; ++j)
+                centers[(std::size_t(i) * moving + j) % count] +=
+                    Vector3{offset(rng), offset(rng), offset(rng)};
+            const Matrix4 camera =
+                Matrix4::rotationY(OrbitStep * Float(i)) *
+                Matrix4::lookAt({0.0f, 20.0f, 120.0f}, {}, Vector3::yAxis());
+            cameraPosition = camera.translation();
+            viewDirection = -camera.backward();
+        };
+        auto restart = [&] {
+            Utility::copy(initialCenters, centers);
+            rng.seed(7);
+        };
+
+        Containers::Array<UnsignedInt> indices{NoInit, count};
+        Containers::Array<Float> depths{NoInit, count};
+        Vector3 cameraPosition, viewDirection;
+
+        restart();
+        const Double standard = measure(iterations, [&](Int i) {
+            frame(i, cameraPosition, viewDirection);
+            std::iota(indices.begin(), indices.end(), 0u);
+            for (std::size_t j = 0; j != count; ++j)
+                depths[j] =
+                    Math::dot(centers[j] - cameraPosition, viewDirection);
+            std::sort(indices.begin(), indices.end(),
+                      [&](UnsignedInt a, UnsignedInt b) {
+                          return depths[a] < depths[b];
+                      });
+        });
+
+        restart();
+        DepthSorter sorter;
+        const Double scratch = measure(iterations, [&](Int i) {
+            frame(i, cameraPosition, viewDirection);
+            std::iota(indices.begin(), indices.end(), 0u);
+            sorter.reset();
+            sorter.sort(centers, cameraPosition, viewDirection, indices);
+        });
+
+        restart();
+        sorter.reset();
+        Int incrementalFrames = 0;
+        const Double incremental = measure(iterations, [&](Int i) {
+            frame(i, cameraPosition, viewDirection);
+            std::iota(indices.begin(), indices.end(), 0u);
+            sorter.sort(centers, cameraPosition, viewDirection, indices);
+            if (sorter.lastSortIncremental())
+                ++incrementalFrames;
+        });
+
+        /* Largest depth by which the last order is out of place */
+        Float maxError = 0.0f, maxDepth = -Constants::inf();
+        for (const UnsignedInt index : indices) {
+            const Float depth =
+                Math::dot(centers[index] - cameraPosition, viewDirection);
+            maxError = Math::max(maxError, maxDepth - depth);
+            maxDepth = Math::max(maxDepth, depth);
+        }
+
+        const Double perInstance = Double(count) * iterations;
+        std::printf("  {\"instances\": %zu, \"iterations\": %d, "
+                    "\"stdSortNsPerInstance\": %.3f, "
+                    "\"radixNsPerInstance\": %.3f, "
+                    "\"incrementalNsPerInstance\": %.3f, "
+                    "\"incrementalFrames\": %d, "
+                    "\"incrementalFrameMs\": %.3f, "
+                    "\"maxDepthError\": %.4f}%s\n",
+                    count, iterations, standard / perInstance,
+                    scratch / perInstance, incremental / perInstance,
+                    incrementalFrames, incremental / (1.0e6 * iterations),
+                    Double(maxError),
+                    c + 1 == instanceCounts.size() ? "" : ",");
+    }
+    std::printf("]\n");
+
+    return 0;
+}
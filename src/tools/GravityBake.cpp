@@ -0,0 +1,70 @@
+#include "Simulation.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/String.h>
+#include <Corrade/Containers/StringStl.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Path.h>
+
+#include <chrono>
+#include <cstdio>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addArgument("output")
+        .setHelp("output", "where to write the baked gravity blob")
+        .addOption("size", "64")
+        .setHelp("size", "number of samples along each axis", "N")
+        .addOption("extent", "16")
+        .setHelp("extent",
+                 "half size of the baked range, centered at the origin", "X")
+        .setGlobalHelp("Bakes the gravity sources of the playground into a "
+                       "grid and reports the interpolation error as JSON.")
+        .parse(argc, argv);
+
+    const Containers::String output = args.value("output");
+    const Int size = args.value<Int>("size");
+    const Float extent = args.value<Float>("extent");
+    if (size < 2 || extent <= 0.0f) {
+        Error{} << "Expected --size to be at least 2 and --extent positive";
+        return 1;
+    }
+
+    /* The gravity sources are set up by the simulation itself, so the tool
+       bakes exactly what the application would */
+    Simulation simulation;
+    const auto start = std::chrono::steady_clock::now();
+    const BakedGravityField baked{simulation.gravityFields(),
+                                  Range3D{Vector3{-extent}, Vector3{extent}},
+                                  Vector3i{size}};
+    const Double bakeMs = std::chrono::duration<Double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+    const BakedGravityField::ErrorReport report =
+        baked.errorReport(simulation.gravityFields());
+
+    const Containers::Array<char> blob = baked.serialize();
+    if (!Utility::Path::write(output, blob)) {
+        Error{} << "Can't write" << output;
+        return 1;
+    }
+
+    std::printf("{\n  \"size\": %d,\n  \"extent\": %g,\n"
+                "  \"bytes\": %zu,\n  \"bakeMs\": %.3f,\n"
+                "  \"sampleCount\": %zu,\n  \"maxError\": %g,\n"
+                "  \"meanError\": %g,\n"
+                "  \"maxErrorPosition\": [%g, %g, %g],\n"
+                "  \"maxMagnitude\": %g\n}\n",
+                size, Double(extent), blob.size(), bakeMs,
+                report.sampleCount, Double(report.maxError),
+                Double(report.meanError),
+                Double(report.maxErrorPosition.x()),
+                Double(report.maxErrorPosition.y()),
+                Double(report.maxErrorPosition.z()),
+                Double(report.maxMagnitude));
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "InputRecording.h"
+#include "Simulation.h"
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Containers/String.h>
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Path.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace Corrade;
+using namespace GraphicsPlayground;
+
+namespace {
+
+/* Nearest-rank percentile of an already sorted array */
+Double percentile(Containers::ArrayView<const Double> sorted, Double p) {
+    const std::size_t rank = std::size_t(std::ceil(p * Double(sorted.size())));
+    return sorted[std::min(std::max(rank, std::size_t{1}), sorted.size()) - 1];
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Utility::Arguments args;
+    args.addArgument("recording")
+        .setHelp("recording", "session recorded with playground --record")
+        .setGlobalHelp("Replays a recorded session without a window as fast "
+                       "as possible, reports the frame timings as JSON and "
+                       "checks the end state against the recording. Exits "
+                       "with 1 if it doesn't match, so it can drive a "
+                       "git bisect run.")
+        .parse(argc, argv);
+
+    const Containers::String filename = args.value("recording");
+    const Containers::Optional<Containers::Array<char>> data =
+        Utility::Path::read(filename);
+    if (!data) {
+        Error{} << "Can't read" << filename;
+        return 1;
+    }
+    const Containers::Optional<InputRecording> recording =
+        InputRecording::deserialize(*data);
+    if (!recording)
+        return 1;
+    if (recording->frames().isEmpty()) {
+        Error{} << filename << "has no frames";
+        return 1;
+    }
+
+    /* Same bodies and the single Bullet thread the application recorded
+       the session with */
+    Simulation::setThreadCount(1);
+    Containers::Pointer<Simulation> simulation{new Simulation};
+    for (const Vector3 &position : recording->boxes())
+        simulation->addBox(position);
+
+    const Containers::ArrayView<const InputFrame> frames =
+        recording->frames();
+    Containers::Array<Double> times{NoInit, frames.size()};
+    Long ticks = 0;
+    for (std::size_t i = 0; i != frames.size(); ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        ticks += simulation->runFrame(frames[i]);
+        times[i] = std::chrono::duration<Double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    }
+
+    Double total = 0.0, recordedDuration = 0.0;
+    for (Double time : times)
+        total += time;
+    for (const InputFrame &frame : frames)
+        recordedDuration += Double(frame.duration);
+    std::sort(times.begin(), times.end());
+
+    const UnsignedLong checksum = simulation->stateChecksum();
+    const Containers::Optional<UnsignedLong> expected = recording->checksum();
+    const bool matches = expected && *expected == checksum;
+    std::printf("{\n  \"frames\": %zu,\n  \"boxes\": %zu,\n"
+                "  \"ticks\": %lld,\n  \"recordedSeconds\": %.3f,\n"
+                "  \"totalMs\": %.3f,\n  \"meanFrameMs\": %.4f,\n"
+                "  \"p99FrameMs\": %.4f,\n  \"maxFrameMs\": %.4f,\n"
+                "  \"checksum\": \"%016llx\",\n",
+                frames.size(), recording->boxes().size(),
+                static_cast<long long>(ticks), recordedDuration, total,
+                total / Double(frames.size()), percentile(times, 0.99),
+                times.back(),
+                static_cast<unsigned long long>(checksum));
+    if (expected)
+        std::printf("  \"expectedChecksum\": \"%016llx\",\n",
+                    static_cast<unsigned long long>(*expected));
+    else
+        std::printf("  \"expectedChecksum\": null,\n");
+    std::printf("  \"matches\": %s\n}\n", matches ? "true" : "false");
+    return matches ? 0 : 1;
+}